@@ -13,11 +13,9 @@ uniform sampler2D textureDarkSampler;
 uniform sampler2D textureNormalSampler;
 uniform sampler2D textureMaskSampler;
 
-uniform vec3 lightColour;
-
-uniform float shineDamper;
-uniform float reflectivity;
-uniform float diffuse;
+#include "../common/frame-data.glsl"
+#include "../common/material.glsl"
+#include "../common/lighting.glsl"
 
 void main(void){
 
@@ -29,17 +27,13 @@ void main(void){
 	vec3 unitNormal = normalize(normalMapValue.xyz);
 	vec3 unitLight = normalize(toLightVector);
 	vec3 unitCamera = normalize(toCameraVector);
-	vec3 lightDir = -unitLight;
-	vec3 refLightDir = reflect(lightDir, unitNormal);
 
-	float specularFactor = dot(refLightDir, unitCamera);
-	specularFactor = max(specularFactor, 0.0);
-	float dampedFactor = pow(specularFactor, shineDamper);
-	vec3 finalSpec = dampedFactor * reflectivity * lightColour;
+	float specularFactor = specular_factor(unitNormal, unitLight, unitCamera);
+	vec3 finalSpec = specular(specularFactor, shineDamper, reflectivity) * lightColour.xyz;
 
 	float nDotl = dot(unitNormal, unitLight);
-	float brightness = max(nDotl, diffuse);
-	vec3 diffuse = brightness * lightColour;
+	float brightness = diffuse_brightness(unitNormal, unitLight, ambient);
+	vec3 diffuse = brightness * lightColour.xyz;
 
 	vec4 light_color = texture(textureSampler, tex_coords);
 	vec4 dark_color = texture(textureDarkSampler, tex_coords);
@@ -1,9 +1,9 @@
 #version 400 core
 
-in vec3 position;
-in vec2 textureCoords;
-in vec3 normal;
-in vec3 tangent;
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 textureCoords;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec4 tangent; // w: bitangent sign
 
 out vec3 surfaceNormal;
 out vec3 toLightVector;
@@ -13,22 +13,20 @@ out vec2 textCoords;
 out vec3 tangCoords;
 
 uniform mat4 transformationMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 cameraMatrix;
 
-uniform vec3 lightPosition;
+#include "../common/frame-data.glsl"
 
 void main(void){
 	vec4 worldPosition = transformationMatrix * vec4(position.xyz, 1.0);
 	gl_Position = projectionMatrix * cameraMatrix * worldPosition;
 	textCoords = textureCoords;
-	tangCoords = tangent;
+	tangCoords = tangent.xyz;
 
 	surfaceNormal = (transformationMatrix * vec4(normal, 0.0)).xyz;
 
 	vec3 norm = normalize(surfaceNormal);
-	vec3 tang = normalize((transformationMatrix * vec4(tangent, 0.0)).xyz);
-	vec3 bitang = normalize(cross(norm, tang));
+	vec3 tang = normalize((transformationMatrix * vec4(tangent.xyz, 0.0)).xyz);
+	vec3 bitang = normalize(cross(norm, tang)) * tangent.w;
 
 	mat3 toTangentSpace = mat3(
 		tang.x, bitang.x, norm.x,
@@ -38,6 +36,6 @@ void main(void){
 
 	surfaceNormal = toTangentSpace * surfaceNormal;
 
-	toLightVector = toTangentSpace * (lightPosition - worldPosition.xyz);
-	toCameraVector = toTangentSpace * ((inverse(cameraMatrix) * vec4(0.0, 0.0, 0.0, 1.0)).xyz - worldPosition.xyz);
+	toLightVector = toTangentSpace * (lightPosition.xyz - worldPosition.xyz);
+	toCameraVector = toTangentSpace * (cameraPosition.xyz - worldPosition.xyz);
 }
\ No newline at end of file
@@ -0,0 +1,9 @@
+// Shared by every program, bound to uniform_binding::frame
+layout(std140) uniform FrameData
+{
+	mat4 cameraMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightPosition;
+	vec4 lightColour;
+};
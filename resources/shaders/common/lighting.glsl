@@ -0,0 +1,18 @@
+// Phong terms shared by the lit shaders, all vectors normalized
+
+float diffuse_brightness(vec3 unitNormal, vec3 lightDir, float ambientLevel)
+{
+	return max(dot(unitNormal, lightDir), ambientLevel);
+}
+
+// Cosine between the reflected light and the view direction, clamped at zero
+float specular_factor(vec3 unitNormal, vec3 lightDir, vec3 unitCamera)
+{
+	vec3 refLightDir = reflect(-lightDir, unitNormal);
+	return max(dot(refLightDir, unitCamera), 0.0);
+}
+
+float specular(float specularFactor, float shine, float strength)
+{
+	return pow(specularFactor, shine) * strength;
+}
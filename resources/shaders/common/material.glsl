@@ -0,0 +1,8 @@
+// Per shader object, bound to uniform_binding::material
+layout(std140) uniform Material
+{
+	float ambient;
+	float shineDamper;
+	float reflectivity;
+	float distortion;
+};
@@ -9,9 +9,8 @@ out vec4 out_color;
 
 uniform sampler2D textureSampler;
 
-uniform float shineDamper;
-uniform float reflectivity;
-uniform float ambient;
+#include "../common/material.glsl"
+#include "../common/lighting.glsl"
 
 void main(void){
 	vec2 tex = vec2(textCoords.x, 1 - textCoords.y);
@@ -19,21 +18,15 @@ void main(void){
 	vec3 unitNormal = normalize(surfaceNormal);
 	vec3 lightDir = normalize(toLightVector);
 	vec3 unitCamera = normalize(toCameraVector);
-	vec3 refLightDir = reflect(-lightDir, unitNormal);
 
-	float specularFactor = dot(refLightDir, unitCamera);
-	specularFactor = max(specularFactor, 0.0);
-	float dampedFactor = pow(specularFactor, shineDamper);
-	vec4 finalSpec = dampedFactor * reflectivity * vec4(1.0, 1.0, 1.0, 1.0);
+	float specularFactor = specular_factor(unitNormal, lightDir, unitCamera);
+	vec4 finalSpec = specular(specularFactor, shineDamper, reflectivity) * vec4(1.0, 1.0, 1.0, 1.0);
 
-	float nDotl = dot(unitNormal, lightDir);
-	float brightness = max(nDotl, ambient);
+	float brightness = diffuse_brightness(unitNormal, lightDir, ambient);
 	vec4 lighting = brightness * vec4(1.0, 1.0, 1.0, 1.0);
 
 	vec4 color = texture(textureSampler, tex);
 
-	float s = smoothstep(-0.05, 0.05, nDotl);
-
 	lighting = lighting + finalSpec;
 
 	out_color = lighting * color;
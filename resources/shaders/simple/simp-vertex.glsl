@@ -1,9 +1,9 @@
 #version 400 core
 
-in vec3 position;
-in vec2 textureCoords;
-in vec3 normal;
-in vec3 tangent;
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 textureCoords;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec3 tangent;
 
 out vec3 surfaceNormal;
 out vec3 toLightVector;
@@ -12,10 +12,8 @@ out vec3 toCameraVector;
 out vec2 textCoords;
 
 uniform mat4 transformationMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 cameraMatrix;
 
-uniform vec3 lightPosition;
+#include "../common/frame-data.glsl"
 
 void main(void){
 	vec4 worldPosition = transformationMatrix * vec4(position.xyz, 1.0);
@@ -24,6 +22,6 @@ void main(void){
 	textCoords = textureCoords;
 
 	surfaceNormal = (transformationMatrix * vec4(normal, 0.0)).xyz;
-	toLightVector = lightPosition - worldPosition.xyz;
-	toCameraVector = (inverse(cameraMatrix) * vec4(0.0, 0.0, 0.0, 1.0)).xyz - worldPosition.xyz;
+	toLightVector = lightPosition.xyz - worldPosition.xyz;
+	toCameraVector = cameraPosition.xyz - worldPosition.xyz;
 }
\ No newline at end of file
@@ -1,5 +1,10 @@
 #version 400 core
 
+// Permutations, see tube_shader:
+// NORMAL_MAPPING - tube surface with the normal map, off for the glass scatter pieces
+// DAMAGED        - samples the decal atlases around the hit point of the instance
+// REFRACTION     - blends in the refraction pass, otherwise glass shows its own colour
+
 in vec2 textCoords;
 in vec3 surfaceNormal;
 in vec3 toLightVector;
@@ -7,6 +12,8 @@ in vec3 toCameraVector;
 in vec4 clipSpace;
 in vec3 refractedVector;
 in vec3 surfaceTangent;
+flat in vec2 decalUvs;
+flat in int decalId;
 
 out vec4 out_color;
 
@@ -16,17 +23,9 @@ uniform sampler2D textureNormalSampler;
 uniform sampler2D destructionSampler;
 uniform sampler2D glassSampler;
 
-uniform float shineDamper;
-uniform float reflectivity;
-uniform float shineDamper2;
-uniform float reflectivity2;
-uniform float ambient;
-uniform float distortion;
-
-uniform float do_normal_mapping;
+#include "../common/material.glsl"
+#include "../common/lighting.glsl"
 
-uniform vec2 decal_uvs;
-uniform int decal_id;
 uniform int decal_variations;
 
 precision lowp    float;
@@ -42,14 +41,14 @@ float gold_noise(in vec2 coordinate, in float seed){
 vec2 calc_decal_tex(vec2 scale, vec2 tex)
 {
 	vec2 decal_tex = vec2(
-		((decal_uvs.x - tex.x)* 2.0 * scale.x * 0.4f + 0.5) , 
-		((1.0 - decal_uvs.y - tex.y)* 1.2 * scale.y + 0.5)
+		((decalUvs.x - tex.x)* 2.0 * scale.x * 0.4f + 0.5) , 
+		((1.0 - decalUvs.y - tex.y)* 1.2 * scale.y + 0.5)
 	);
 	decal_tex.x = max(0, min(1, decal_tex.x));
 	decal_tex.y = max(0, min(1, decal_tex.y));
 
-	int i = decal_id / decal_variations;
-	int j = decal_id % decal_variations;
+	int i = decalId / decal_variations;
+	int j = decalId % decal_variations;
 	decal_tex.x = decal_tex.x / decal_variations + float(i) / decal_variations;
 	decal_tex.y = decal_tex.y / decal_variations + float(j) / decal_variations;
 
@@ -67,29 +66,31 @@ void main(void){
 
 	vec2 tex = vec2(textCoords.x, 1 - textCoords.y);
 
-	vec4 normalMapValue = 2.0 * texture(textureNormalSampler, tex) - 1.0;
-
 	vec3 unitNormal = normalize(surfaceNormal.xyz);
 
 	vec3 lightDir = normalize(toLightVector);
 	vec3 unitCamera = normalize(toCameraVector);
 
 	float nDotc0 = dot(unitNormal, unitCamera);
-	if (nDotc0 * do_normal_mapping > 0) {
+
+#ifdef NORMAL_MAPPING
+	vec4 normalMapValue = 2.0 * texture(textureNormalSampler, tex) - 1.0;
+	// Normal maps may be stored with two channels (BC5), rebuild z
+	normalMapValue.z = sqrt(max(0.0, 1.0 - dot(normalMapValue.xy, normalMapValue.xy)));
+
+	if (nDotc0 > 0) {
 		unitNormal = normalize(normalMapValue.xyz);
 	}
+#endif
 
 	vec4 color = texture(textureSampler, tex);
 
-	//color.x = ;
-
 	float mask_val = 1 - color.w;
 	color.w = 1.0;
 
 	vec2 clip_xy = clipSpace.xy;
 
-	vec2 clip_xyn = ((clip_xy / clipSpace.w) / 2.0 + 0.5);
-
+#ifdef DAMAGED
 	vec2 decal_tex = calc_decal_tex(vec2(length(surfaceTangent), 1.f), tex);
 	vec2 glass_tex = calc_decal_tex(vec2(length(surfaceTangent) * 0.5f, 0.5f), tex);
 
@@ -98,7 +99,8 @@ void main(void){
 
 	float near_decal = (1 - dest_space.w);
 
-	if (do_normal_mapping > 0 && mask_val > 0)
+#ifdef NORMAL_MAPPING
+	if (mask_val > 0)
 	{
 		color.xyz *= (vec3(glass_diffuse.z) * 1.5 + 1.0);
 		color.xyz += (vec3(glass_diffuse.z) * gold_noise(glass_tex, 2.0) * 0.5);
@@ -143,36 +145,43 @@ void main(void){
 			}
 			else
 			{
+				// Hole in the glass
+#ifdef REFRACTION
+				vec2 clip_xyn = ((clip_xy / clipSpace.w) / 2.0 + 0.5);
 				out_color = texture(refractionSampler, clip_xyn) * 0.5;
 				return;
+#else
+				discard;
+#endif
 			}
 		}
 	}
+#endif
 
-	//vec3 to_decal = normalize(vec3(decal_uvs.x - tex.x, decal_uvs.y - tex.y, 0.0));
+	//vec3 to_decal = normalize(vec3(decalUvs.x - tex.x, decalUvs.y - tex.y, 0.0));
 	//unitNormal = unitNormal + near_decal * vec3(to_decal);
 	decal_tex = vec2(
-		((decal_uvs.x - tex.x)* 5.0 ) , 
-		((1.0 - decal_uvs.y - tex.y)* 5.0)
+		((decalUvs.x - tex.x)* 5.0 ) , 
+		((1.0 - decalUvs.y - tex.y)* 5.0)
 	);
 	unitNormal = unitNormal + sin(near_decal) * vec3(decal_tex, 0.0);
 	unitNormal = normalize(unitNormal);
+#endif
 
-	vec3 refLightDir = reflect(-lightDir, unitNormal);
-
-	float specularFactor = dot(refLightDir, unitCamera);
-	specularFactor = max(specularFactor, 0.0);
-	float dampedFactor = pow(specularFactor, shineDamper);
-	vec4 finalSpec = dampedFactor * reflectivity_copy * vec4(1.0, 1.0, 1.0, 1.0);
-
-	float dampedFactor2 = pow(specularFactor, shineDamper2);
-	vec4 finalSpec2 = dampedFactor2 * reflectivity2 * vec4(1.0, 1.0, 1.0, 1.0);
+	float specularFactor = specular_factor(unitNormal, lightDir, unitCamera);
+	vec4 finalSpec = specular(specularFactor, shineDamper, reflectivity_copy) * vec4(1.0, 1.0, 1.0, 1.0);
+	vec4 finalSpec2 = specular(specularFactor, shineDamper * 2.0, reflectivity * 2.0) * vec4(1.0, 1.0, 1.0, 1.0);
 
-	float nDotl = dot(unitNormal, lightDir);
 	float nDotc = abs(nDotc0);
-	float brightness = max(nDotl, ambient_copy);
+	float brightness = diffuse_brightness(unitNormal, lightDir, ambient_copy);
 	vec4 lighting = brightness * vec4(1.0, 1.0, 1.0, 1.0);
 
+	float refract_factor = pow(nDotc, 2) * (1.0 - refraction_killer);
+
+	vec4 lighting2 = lighting + finalSpec2;
+	vec4 lighting1 = lighting + finalSpec * (1 - refract_factor);
+
+#ifdef REFRACTION
 	nDotc0 = max(min(abs(nDotc0), 1), 0);
 	nDotc0 = pow(nDotc0, 5);
 	clip_xy = mix(1 - distortion_copy, 1 + distortion_copy, nDotc0) * clip_xy;
@@ -181,13 +190,10 @@ void main(void){
 
 	vec4 color2 = texture(refractionSampler, ndc);
 
-	float refract_factor = pow(nDotc, 2) * (1.0 - refraction_killer);
-
-	vec4 lighting2 = lighting + finalSpec2;
-	vec4 lighting1 = lighting + finalSpec * (1 - refract_factor);
-	
-
 	vec4 glassTotal = mix(color, color2, refract_factor);
+#else
+	vec4 glassTotal = color;
+#endif
 
 	out_color = mix(lighting2 *color, lighting1 * glassTotal, mask_val);
 
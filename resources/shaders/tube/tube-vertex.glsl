@@ -1,9 +1,16 @@
 #version 400 core
 
-in vec3 position;
-in vec2 textureCoords;
-in vec3 normal;
-in vec3 tangent;
+// Permutations: NORMAL_MAPPING (lighting in tangent space), 
+// DAMAGED and REFRACTION are used by the fragment shader only
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 textureCoords;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec4 tangent; // w: bitangent sign
+
+// Per-instance attributes, used when instanced > 0
+layout(location = 4) in mat4 instanceMatrix;
+layout(location = 8) in vec4 instanceDecal; // xy: uvs, z: decal id
 
 out vec3 surfaceTangent;
 out vec3 surfaceNormal;
@@ -14,25 +21,36 @@ out vec3 refractedVector;
 out vec2 textCoords;
 out vec4 clipSpace;
 
+flat out vec2 decalUvs;
+flat out int decalId;
+
 uniform mat4 transformationMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 cameraMatrix;
 
-uniform vec3 lightPosition;
+#include "../common/frame-data.glsl"
 
-uniform float do_normal_mapping;
+uniform float instanced;
 
 void main(void){
-	vec4 worldPosition = transformationMatrix * vec4(position.xyz, 1.0);
+	mat4 modelMatrix = transformationMatrix;
+	decalUvs = vec2(0.0);
+	decalId = 0;
+	if (instanced > 0.0)
+	{
+		modelMatrix = instanceMatrix;
+		decalUvs = instanceDecal.xy;
+		decalId = int(instanceDecal.z + 0.5);
+	}
+
+	vec4 worldPosition = modelMatrix * vec4(position.xyz, 1.0);
 
 	textCoords = textureCoords;
 
-	surfaceNormal = (transformationMatrix * vec4(normal, 0.0)).xyz;
+	surfaceNormal = (modelMatrix * vec4(normal, 0.0)).xyz;
 
 	vec3 norm = normalize(surfaceNormal);
-	surfaceTangent = (transformationMatrix * vec4(tangent, 0.0)).xyz;
+	surfaceTangent = (modelMatrix * vec4(tangent.xyz, 0.0)).xyz;
 	vec3 tang = normalize(surfaceTangent);
-	vec3 bitang = normalize(cross(norm, tang));
+	vec3 bitang = normalize(cross(norm, tang)) * tangent.w;
 
 	mat3 toTangentSpace = mat3(
 		tang.x, bitang.x, norm.x,
@@ -43,20 +61,16 @@ void main(void){
 	clipSpace = projectionMatrix * cameraMatrix * worldPosition;
 	gl_Position = clipSpace;
 
-	vec3 cameraPos = (inverse(cameraMatrix) * vec4(0.0, 0.0, 0.0, 1.0)).xyz;
+	vec3 cameraPos = cameraPosition.xyz;
 
-	if (do_normal_mapping > 0.0)
-	{
-		surfaceNormal = toTangentSpace * surfaceNormal;
-		toLightVector = toTangentSpace * (lightPosition - worldPosition.xyz);
-		toCameraVector = toTangentSpace * (cameraPos - worldPosition.xyz);
-	}
-	else
-	{
-		surfaceNormal = surfaceNormal;
-		toLightVector = (lightPosition - worldPosition.xyz);
-		toCameraVector = (cameraPos - worldPosition.xyz);
-	}
+#ifdef NORMAL_MAPPING
+	surfaceNormal = toTangentSpace * surfaceNormal;
+	toLightVector = toTangentSpace * (lightPosition.xyz - worldPosition.xyz);
+	toCameraVector = toTangentSpace * (cameraPos - worldPosition.xyz);
+#else
+	toLightVector = (lightPosition.xyz - worldPosition.xyz);
+	toCameraVector = (cameraPos - worldPosition.xyz);
+#endif
 
 	refractedVector = refract(normalize(worldPosition.xyz - cameraPos), surfaceNormal, 1.0 / 1.33);
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "frustum.h"
+
+#include <math.h>
+
+frustum::frustum(const float4x4& m)
+{
+    // Gribb-Hartmann: rows of the clip matrix combined pairwise
+    auto row = [&](int i) { return float4{ m[0][i], m[1][i], m[2][i], m[3][i] }; };
+
+    _planes[0] = row(3) + row(0); // Left
+    _planes[1] = row(3) - row(0); // Right
+    _planes[2] = row(3) + row(1); // Bottom
+    _planes[3] = row(3) - row(1); // Top
+    _planes[4] = row(3) + row(2); // Near
+    _planes[5] = row(3) - row(2); // Far
+
+    for (auto& p : _planes)
+    {
+        auto l = length(p.xyz());
+        if (l > 0.f) p = p / l;
+    }
+}
+
+bool frustum::intersects(const float3& lo, const float3& hi) const
+{
+    for (auto& p : _planes)
+    {
+        // Corner furthest along the plane normal
+        float3 v{
+            p.x >= 0.f ? hi.x : lo.x,
+            p.y >= 0.f ? hi.y : lo.y,
+            p.z >= 0.f ? hi.z : lo.z,
+        };
+        if (dot(p.xyz(), v) + p.w < 0.f) return false;
+    }
+    return true;
+}
+
+bool frustum::intersects(const float3& center, float radius) const
+{
+    for (auto& p : _planes)
+        if (dot(p.xyz(), center) + p.w < -radius) return false;
+    return true;
+}
+
+void sphere_batch::clear()
+{
+    _x.clear();
+    _y.clear();
+    _z.clear();
+    _radius.clear();
+}
+
+void sphere_batch::reserve(int count)
+{
+    _x.reserve(count);
+    _y.reserve(count);
+    _z.reserve(count);
+    _radius.reserve(count);
+}
+
+void sphere_batch::add(const float3& center, float radius)
+{
+    _x.push_back(center.x);
+    _y.push_back(center.y);
+    _z.push_back(center.z);
+    _radius.push_back(radius);
+}
+
+void sphere_batch::cull(const frustum& f, std::vector<int>& visible)
+{
+    const int n = size();
+    _inside.assign(n, 1);
+
+    const float* x = _x.data();
+    const float* y = _y.data();
+    const float* z = _z.data();
+    const float* r = _radius.data();
+    uint8_t* inside = _inside.data();
+
+    // One plane at a time over all spheres, branch-free inner loop
+    for (int k = 0; k < frustum::plane_count; k++)
+    {
+        const auto p = f.plane(k);
+        for (int i = 0; i < n; i++)
+        {
+            float d = p.x * x[i] + p.y * y[i] + p.z * z[i] + p.w;
+            inside[i] &= (uint8_t)(d >= -r[i]);
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+        if (inside[i]) visible.push_back(i);
+}
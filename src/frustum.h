@@ -0,0 +1,45 @@
+#pragma once
+
+#include "util.h"
+
+#include <vector>
+#include <stdint.h>
+
+// View frustum as six inward facing planes (xyz: normal, w: distance),
+// extracted from a combined projection * view matrix
+class frustum
+{
+public:
+    frustum() {}
+    explicit frustum(const float4x4& view_projection);
+
+    // Conservative: may report boxes near the corners as visible
+    bool intersects(const float3& lo, const float3& hi) const;
+    bool intersects(const float3& center, float radius) const;
+
+    const float4& plane(int i) const { return _planes[i]; }
+
+    static const int plane_count = 6;
+
+private:
+    float4 _planes[plane_count];
+};
+
+// Bounding spheres stored as separate arrays, so the plane tests
+// run over contiguous floats and vectorize
+class sphere_batch
+{
+public:
+    void clear();
+    void reserve(int count);
+    void add(const float3& center, float radius);
+
+    // Appends positions (in order of add) of the spheres intersecting the frustum
+    void cull(const frustum& f, std::vector<int>& visible);
+
+    int size() const { return (int)_radius.size(); }
+
+private:
+    std::vector<float> _x, _y, _z, _radius;
+    std::vector<uint8_t> _inside;
+};
@@ -2,7 +2,7 @@
 #include "easylogging++.h"
 
 glass_decals_shader::glass_decals_shader()
-    : texture_2d_shader(shader_program::load(
+    : texture_2d_shader(shader_registry::current().get(
         "resources/shaders/planar/decal-atlas-vertex.glsl",
         "resources/shaders/planar/decal-atlas-fragment.glsl"))
 {
@@ -19,7 +19,7 @@ void glass_decals_shader::set_width_height(bool horizontal, int w, int h)
 }
 
 radial_shader::radial_shader()
-    : texture_2d_shader(shader_program::load(
+    : texture_2d_shader(shader_registry::current().get(
         "resources/shaders/planar/plane-vertex.glsl",
         "resources/shaders/planar/radial-fragment.glsl"))
 {
@@ -32,7 +32,7 @@ void radial_shader::set_decals_count(int count)
 }
 
 normal_mapper_shader::normal_mapper_shader()
-    : simple_shader(shader_program::load(
+    : simple_shader(shader_registry::current().get(
         "resources/shaders/simple/simp-vertex.glsl",
         "resources/shaders/simple/normal-mapper.glsl"))
 {
@@ -55,21 +55,28 @@ void glass_atlas::generate_decals(texture_handle white)
 
     simple_shader shader;
 
+    // Orthographic view of the whole atlas, lit head-on. 
+    // Replaces the frame block until the next frame starts
+    frame_data atlas_frame;
+    atlas_frame.view = scaling_matrix(float3{ 2.f / glass_variations, 2.f / glass_variations, -0.5f });
+    atlas_frame.projection = create_orthographic_projection_matrix(
+        glass_impact->get_width(),
+        glass_impact->get_height(), glass_impact->get_width(), 0.1f, 1000.f);
+    atlas_frame.camera_position = { 0.f, 0.f, 0.f, 1.f };
+    atlas_frame.light_position = { 0.f, 0.f, -1.f, 1.f };
+    atlas_frame.light_colour = { 1.f, 1.f, 1.f, 1.f };
+
+    uniform_block<frame_data> frame;
+    frame.set(atlas_frame);
+    frame.bind(uniform_binding::frame);
+
     glass_impact->bind();
     shader.begin();
     glClearColor(0, 0, 0, 1);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    shader.set_light({ 0.f, 0.f, -1.f });
     shader.set_material_properties(1.f, 1.f, 0.f);
 
-    auto projection = create_orthographic_projection_matrix(
-        glass_impact->get_width(),
-        glass_impact->get_height(), glass_impact->get_width(), 0.1f, 1000.f);
-    shader.set_mvp(identity_t{},
-        scaling_matrix(float3{ 2.f / glass_variations, 2.f / glass_variations, -0.5f }),
-        projection);
-
     _textures.with_texture(white, 0, [&]() {
         int index = 0;
         for (auto& gm : _glass_models)
@@ -128,11 +135,7 @@ void glass_atlas::generate_decals(texture_handle white)
 
         auto shader2 = std::make_shared<normal_mapper_shader>();
         shader2->begin();
-        shader2->set_light({ 0.f, 0.f, -1.f });
         shader2->set_material_properties(1.f, 1.f, 0.f);
-        shader2->set_mvp(identity_t{},
-            scaling_matrix(float3{ 2.f / glass_variations, 2.f / glass_variations, -0.5f }),
-            projection);
 
         _textures.with_texture(white, 0, [&]() {
             int index = 0;
@@ -219,63 +222,52 @@ void glass_atlas::reload_fbos()
     texture_atlas->createTextureAttachment(_textures.get(diffuse_glass_atlas), false);
 }
 
-glass_atlas::glass_atlas(textures& tex) : _textures(tex)
+glass_atlas::glass_atlas(worker_pool& pool, textures& tex) : _textures(tex)
 {
     temp_glass_atlas = _textures.add_texture("temp_glass_atlas");
     final_glass_atlas = _textures.add_texture("final_glass_atlas");
     diffuse_glass_atlas = _textures.add_texture("diffuse_glass_atlas");
 
-    for (int i = 0; i < glass_variations*glass_variations; i++)
-    {
-        std::vector<glass_peice> t;
-        generate_broken_glass(t);
-        _glass_models.emplace_back(t);
-    }
-
-    uvs = { 0.f, 0.f };
-    tsp = identity_t{};
+    _glass_models = generate_broken_glass(pool,
+        glass_variations * glass_variations, rand());
 }
 
-void glass_atlas::set_hitpoint(
-    const obj_mesh& mesh, 
+glass_hitpoint glass_atlas::calculate_hitpoint(
+    const mesh_view& mesh, 
     const float4x4& transform,
     int idx, int glass
-    )
+    ) const
 {
-    auto n = mesh.positions.size();
-
-    glass_id = glass % glasses.size();
+    glass_hitpoint res;
 
-    float3 normal;
+    res.decal_id = glass % _glass_models.size();
 
-    float4x4 mat = transform;
+    auto pos = mul(transform, float4(mesh.positions[idx], 1.0)).xyz();
 
-    auto pos = mul(mat, float4(mesh.positions[idx], 1.0)).xyz();
-
-    normal = normalize(mesh.normals[idx]);
+    auto normal = normalize(mesh.normals[idx]);
     auto tangent = normalize(mesh.tangents[idx]);
     auto third = normalize(cross(normal, tangent));
-    tsp = {
+    res.frame = {
         { tangent, 0.f },
         { third, 0.f },
         { normal, 0.f },
         { pos, 1.f }
     };
 
-    uvs = mesh.uvs[idx];
+    res.uvs = mesh.uvs[idx];
+
+    return res;
 }
 
-void glass_atlas::draw_scatter(float t, tube_shader& shader)
+void glass_atlas::draw_scatter(float t, tube_shader& shader, const glass_hitpoint& hitpoint)
 {
     float ambient;
     float reflectivity;
     float shine;
     shader.get_material_properties(ambient, shine, reflectivity);
 
-    shader.enable_normal_mapping(false);
-
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    for (auto& g : glasses[glass_id])
+    for (auto& g : glasses[hitpoint.decal_id])
     {
         if (g.second.dist == 0) continue;
 
@@ -304,17 +296,11 @@ void glass_atlas::draw_scatter(float t, tube_shader& shader)
             rotation_matrix(q)
             );
 
-        view = mul(tsp, view);
+        view = mul(hitpoint.frame, view);
 
         shader.set_model(view);
 
         g.first->draw();
     }
 }
-
-void glass_atlas::prepare_decal(tube_shader & shader)
-{
-    shader.set_decal_id(glass_id, glass_variations);
-    shader.set_decal_uvs(uvs);
-}
 ;
\ No newline at end of file
@@ -33,21 +33,29 @@ public:
     normal_mapper_shader();
 };
 
+// Where a tube was hit, computed once when the tube is damaged
+struct glass_hitpoint
+{
+    float4x4 frame;     // Tangent space of the hit vertex, in world coordinates
+    float2 uvs;         // Decal center in tube texture coordinates
+    int decal_id = 0;   // Glass variation used for this hit
+};
+
 class glass_atlas
 {
 public:
     void release();
 
     void generate_decals(texture_handle white);
-    void draw_scatter(float t, tube_shader& shader);
-    void prepare_decal(tube_shader& shader);
+    // Draws with the tube shader variant the caller selected
+    void draw_scatter(float t, tube_shader& shader, const glass_hitpoint& hitpoint);
 
     const int glass_variations = 4;
 
-    glass_atlas(textures& tex);
+    glass_atlas(worker_pool& pool, textures& tex);
 
-    void set_hitpoint(const obj_mesh& mesh, const float4x4& transform, 
-        int idx, int glass);
+    glass_hitpoint calculate_hitpoint(const mesh_view& mesh, const float4x4& transform, 
+        int idx, int glass) const;
 
     texture_handle diffuse() const { return diffuse_glass_atlas; }
     texture_handle outline() const { return final_glass_atlas; }
@@ -61,8 +69,4 @@ private:
     texture_handle final_glass_atlas;
     texture_handle diffuse_glass_atlas;
     textures& _textures;
-    int glass_id = 0;
-
-    float4x4 tsp;
-    float2 uvs;
 };
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "instancing.h"
+
+#include <GL/gl3w.h>
+#include <stddef.h>
+
+instance_buffer::instance_buffer(int stride)
+    : _buffer(vbo_type::array_buffer), _stride(stride)
+{
+}
+
+void instance_buffer::add_attribute(int location, int size, int offset)
+{
+    _attributes.push_back({ location, size, offset });
+}
+
+void instance_buffer::upload(const void* data, int count)
+{
+    _buffer.stream(data, count * _stride * sizeof(float), count);
+}
+
+void instance_buffer::draw(vao& geometry, int first, int count)
+{
+    if (count <= 0) return;
+
+    geometry.bind();
+    for (auto& a : _attributes)
+    {
+        _buffer.set_attribute(a.location, a.size, _stride, first * _stride + a.offset);
+        glVertexAttribDivisor(a.location, 1);
+        glEnableVertexAttribArray(a.location);
+    }
+
+    geometry.draw_instanced(count);
+
+    // Instance attributes are part of the vao state, 
+    // detach them so regular draws of the same geometry are unaffected
+    geometry.bind();
+    for (auto& a : _attributes)
+    {
+        glDisableVertexAttribArray(a.location);
+        glVertexAttribDivisor(a.location, 0);
+    }
+    geometry.unbind();
+}
+
+std::unique_ptr<instance_buffer> create_tube_instance_buffer()
+{
+    auto res = std::make_unique<instance_buffer>(sizeof(tube_instance) / sizeof(float));
+    for (int i = 0; i < 4; i++)
+        res->add_attribute(4 + i, 4, offsetof(tube_instance, model) / sizeof(float) + i * 4);
+    res->add_attribute(8, 4, offsetof(tube_instance, decal) / sizeof(float));
+    return res;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "util.h"
+#include "vbo.h"
+#include "vao.h"
+
+#include <vector>
+#include <memory>
+#include <assert.h>
+
+// Per-instance data consumed by the tube shader
+struct tube_instance
+{
+    float4x4 model;
+    float4 decal; // xy: decal uvs, z: decal id
+};
+
+// Vertex buffer of per-instance attributes, 
+// attached to a vao only for the duration of an instanced draw
+class instance_buffer
+{
+public:
+    instance_buffer(int stride);
+
+    void add_attribute(int location, int size, int offset);
+
+    void upload(const void* data, int count);
+
+    template<class T>
+    void upload(const std::vector<T>& data)
+    {
+        assert(sizeof(T) == _stride * sizeof(float));
+        upload(data.data(), (int)data.size());
+    }
+
+    // Draws instances [first, first + count) of the geometry
+    void draw(vao& geometry, int first, int count);
+
+    int size() const { return _buffer.size(); }
+
+private:
+    struct attribute
+    {
+        int location, size, offset;
+    };
+
+    vbo _buffer;
+    int _stride;
+    std::vector<attribute> _attributes;
+};
+
+// Tube shader instance layout: model matrix in locations 4-7, decal parameters in 8
+std::unique_ptr<instance_buffer> create_tube_instance_buffer();
\ No newline at end of file
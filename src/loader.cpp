@@ -1,125 +1,240 @@
 #include "loader.h"
-#include <OBJ_Loader.h>
+#include "obj-parser.h"
+#include "mesh-cache.h"
+#include "mesh.h"
 
-void loader::thread_proc(std::string name)
-{
-    objl::Loader loader;
-    bool loadout = loader.LoadFile(name,
-        [&](float p) { _progress = p; });
+#include <chrono>
+#include <cmath>
+#include <algorithm>
 
-    obj_file result;
+#include <easylogging++.h>
 
-    for (int i = 0; i < loader.LoadedMeshes.size(); i++)
-    {
-        objl::Mesh curMesh = loader.LoadedMeshes[i];
+loader::result loader::load(worker_pool& pool, std::string name, std::atomic<float>& progress)
+{
+    using namespace std::chrono;
+    auto start = high_resolution_clock::now();
 
-        std::vector<float3> positions;
-        for (auto&& v : curMesh.Vertices)
+    result res;
+    try
+    {
+        res.cache = mesh_cache::open(name);
+        if (res.cache)
         {
-            positions.emplace_back(v.Position.X, v.Position.Y, v.Position.Z);
-
-            auto length = v.Position.X * v.Position.X +
-                v.Position.Y * v.Position.Y +
-                v.Position.Z * v.Position.Z;
+            LOG(INFO) << "Loaded " << name << " from " << mesh_cache_path(name);
         }
+        else
+        {
+            res.meshes = parse_obj(pool, name, [&](float p) { progress = p * 0.9f; });
+            for (auto& mesh : res.meshes) mesh.calculate_tangents(&pool);
+
+            for (auto& mesh : res.meshes) res.bounds.push_back(calculate_bounding_sphere(mesh));
 
-        std::vector<float3> normals;
-        for (auto&& v : curMesh.Vertices)
-            normals.emplace_back(v.Normal.X, v.Normal.Y, v.Normal.Z);
-        std::vector<float2> uvs;
-        for (auto&& v : curMesh.Vertices)
-            uvs.emplace_back(v.TextureCoordinate.X, v.TextureCoordinate.Y);
-        std::vector<int3> idx;
-        for (int i = 0; i < curMesh.Indices.size(); i += 3)
-            idx.emplace_back(curMesh.Indices[i], curMesh.Indices[i + 1], curMesh.Indices[i + 2]);
-        
-
-        obj_mesh r;
-        r.name = curMesh.MeshName;
-        r.indexes = idx;
-        r.positions = positions;
-        r.normals = normals;
-        r.uvs = uvs;
-        r.calculate_tangents();
-        result.push_back(r);
+            // Upload from the fresh cache as well, the parsed copy is only kept without one
+            if (write_mesh_cache(name, res.meshes, res.bounds)) res.cache = mesh_cache::open(name);
+            if (res.cache) res.meshes.clear();
+            else LOG(WARNING) << "Could not write " << mesh_cache_path(name);
+        }
+        if (res.cache) res.bounds = res.cache->bounds();
+    }
+    catch (const std::exception& ex)
+    {
+        LOG(ERROR) << "Loading " << name << " failed: " << ex.what();
+        res.cache.reset();
+        res.meshes.clear();
+        res.bounds.clear();
     }
 
-    _queue.enqueue(std::move(result));
+    auto duration = high_resolution_clock::now() - start;
+    res.load_time = duration_cast<microseconds>(duration).count() / 1000.f;
+    if (!res.bounds.empty()) LOG(INFO) << name << " loaded in " << res.load_time << " ms";
+
+    progress = 1.f;
+    return res;
 }
 
-void obj_mesh::calculate_tangents()
+void obj_mesh::calculate_tangents(worker_pool* pool)
 {
-    std::vector<float3> tangents(positions.size(), { 0.f,0.f,0.f });
-
-    auto calc_tangent = [](const float3& v0,
-                           const float3& v1,
-                           const float3& v2,
-                           const float2& uv0,
-                           const float2& uv1,
-                           const float2& uv2
-        ) {
-        float3 p0{ v0.x, v0.y,v0.z };
-        float3 p1{ v1.x, v1.y,v1.z };
-        float3 p2{ v2.x, v2.y,v2.z };
-
-        float2 t0{ uv0.x, uv0.y };
-        float2 t1{ uv1.x, uv1.y };
-        float2 t2{ uv2.x, uv2.y };
-
-        auto deltaPos1 = p1 - p0;
-        auto deltaPos2 = p2 - p0;
-
-        auto deltaUv1 = t1 - t0;
-        auto deltaUv2 = t2 - t0;
-
-        auto r = 1 / (deltaUv1.x * deltaUv2.y - deltaUv1.y * deltaUv2.x);
-        auto tangent = -(deltaPos1 * deltaUv2.y - deltaPos2 * deltaUv1.y) * r;
-        return tangent;
-    };
+    const int vertex_count = positions.size();
+    const int triangle_count = indexes.size();
+    const bool has_uvs = uvs.size() == positions.size();
+    const bool has_normals = normals.size() == positions.size();
 
-    for (int i = 0; i < indexes.size(); i++)
+    struct accumulator
     {
-        auto v0 = positions[indexes[i].x];
-        auto v1 = positions[indexes[i].y];
-        auto v2 = positions[indexes[i].z];
+        std::vector<float3> tangents, bitangents;
+        std::vector<float> weights;
+
+        explicit accumulator(int n) 
+            : tangents(n, { 0.f, 0.f, 0.f }), bitangents(n, { 0.f, 0.f, 0.f }), weights(n, 0.f) {}
+    };
 
-        auto uv0 = uvs[indexes[i].x];
-        auto uv1 = uvs[indexes[i].y];
-        auto uv2 = uvs[indexes[i].z];
+    // Every corner adds the triangle's uv derivatives weighted by its angle.
+    // Tangents point along -dP/du, the convention the shaders were written for
+    auto accumulate = [&](accumulator& acc, int first, int last) {
+        for (int i = first; i < last; i++)
+        {
+            int idx[3] = { indexes[i].x, indexes[i].y, indexes[i].z };
+
+            auto e1 = positions[idx[1]] - positions[idx[0]];
+            auto e2 = positions[idx[2]] - positions[idx[0]];
+            auto duv1 = uvs[idx[1]] - uvs[idx[0]];
+            auto duv2 = uvs[idx[2]] - uvs[idx[0]];
+
+            // Degenerate uv mapping, the triangle says nothing about the tangent
+            auto det = duv1.x * duv2.y - duv1.y * duv2.x;
+            if (!std::isfinite(det) || std::abs(det) < 1e-12f) continue;
+
+            auto r = 1.f / det;
+            auto tangent = -(e1 * duv2.y - e2 * duv1.y) * r;
+            auto bitangent = -(e2 * duv1.x - e1 * duv2.x) * r;
+
+            for (int k = 0; k < 3; k++)
+            {
+                auto& p = positions[idx[k]];
+                auto a = positions[idx[(k + 1) % 3]] - p;
+                auto b = positions[idx[(k + 2) % 3]] - p;
+                auto la = length(a), lb = length(b);
+                if (la <= 0.f || lb <= 0.f) continue;
+
+                auto w = std::acos(std::max(-1.f, std::min(1.f, dot(a, b) / (la * lb))));
+                acc.tangents[idx[k]] += tangent * w;
+                acc.bitangents[idx[k]] += bitangent * w;
+                acc.weights[idx[k]] += w;
+            }
+        }
+    };
 
-        tangents[indexes[i].x] = calc_tangent(v0, v1, v2, uv0, uv1, uv2);
-        tangents[indexes[i].y] = calc_tangent(v1, v2, v0, uv1, uv2, uv0);
-        tangents[indexes[i].z] = calc_tangent(v2, v0, v1, uv2, uv0, uv1);
-    }
-    this->tangents = tangents;
+    // Large meshes: contiguous triangle ranges per thread, each with its own accumulator
+    const int min_triangles_per_thread = 16 * 1024;
+    int threads = has_uvs ? std::max(1, std::min(
+        triangle_count / min_triangles_per_thread,
+        pool ? pool->size() + 1 : 1)) : 0;
+
+    auto for_each = [&](int jobs, const std::function<void(int)>& f) {
+        if (pool && jobs > 1) run_parallel(*pool, jobs, f);
+        else for (int i = 0; i < jobs; i++) f(i);
+    };
+
+    std::vector<accumulator> locals;
+    for (int i = 0; i < std::max(threads, 1); i++) locals.emplace_back(vertex_count);
+
+    auto range = [](int count, int parts, int i) {
+        return std::make_pair(count * i / parts, count * (i + 1) / parts);
+    };
+
+    for_each(threads, [&](int k) {
+        auto r = range(triangle_count, threads, k);
+        accumulate(locals[k], r.first, r.second);
+    });
+
+    tangents.resize(vertex_count);
+    tangent_signs.resize(vertex_count);
+
+    // Merge and orthonormalize against the normal. The length of the tangent 
+    // is kept, the tube shader derives the decal scale from it
+    auto& acc = locals.front();
+    auto finalize = [&](int first, int last) {
+        for (int v = first; v < last; v++)
+        {
+            auto t = acc.tangents[v];
+            auto b = acc.bitangents[v];
+            auto w = acc.weights[v];
+            for (size_t j = 1; j < locals.size(); j++)
+            {
+                t += locals[j].tangents[v];
+                b += locals[j].bitangents[v];
+                w += locals[j].weights[v];
+            }
+
+            float3 n{ 0.f, 0.f, 0.f };
+            if (has_normals && length(normals[v]) > 0.f) n = normalize(normals[v]);
+
+            float scale = 0.f;
+            if (w > 0.f)
+            {
+                t = t / w;
+                b = b / w;
+                scale = length(t);
+                t = t - n * dot(n, t);
+            }
+
+            if (scale > 0.f && length(t) > 1e-4f * scale)
+            {
+                tangents[v] = normalize(t) * scale;
+                tangent_signs[v] = dot(cross(n, t), b) < 0.f ? -1.f : 1.f;
+            }
+            else
+            {
+                // No usable uv derivatives: any direction perpendicular to the normal
+                float3 axis = std::abs(n.x) < 0.9f ? float3{ 1.f, 0.f, 0.f } : float3{ 0.f, 1.f, 0.f };
+                tangents[v] = normalize(axis - n * dot(n, axis));
+                tangent_signs[v] = 1.f;
+            }
+        }
+    };
+
+    for_each(std::max(threads, 1), [&](int k) {
+        auto r = range(vertex_count, std::max(threads, 1), k);
+        finalize(r.first, r.second);
+    });
 }
 
 
 loader::~loader()
 {
-    _thread.join();
+    // The job writes into _progress, it has to finish first
+    if (_future.valid()) _future.wait();
 }
 
-std::vector<obj_mesh>& loader::get() 
+int loader::mesh_count() const
 {
     if (!ready()) throw std::runtime_error("Results are not ready!");
-    return _result;
+    return _result.cache ? _result.cache->size() : (int)_result.meshes.size();
+}
+
+const mesh_cache* loader::cache() const
+{
+    if (!ready()) throw std::runtime_error("Results are not ready!");
+    return _result.cache.get();
+}
+
+obj_file& loader::get() 
+{
+    if (!ready()) throw std::runtime_error("Results are not ready!");
+    return _result.meshes;
+}
+
+const std::vector<bounding_sphere>& loader::bounds() const
+{
+    if (!ready()) throw std::runtime_error("Results are not ready!");
+    return _result.bounds;
+}
+
+float loader::get_load_time() const
+{
+    return ready() ? _result.load_time : 0.f;
 }
 
 bool loader::ready() const
 {
-    if (!_ready)
+    if (!_ready && 
+        _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
     {
-        if (_queue.try_dequeue(_result))
-        {
-            _ready = true;
-        }
+        _result = _future.get();
+        _ready = true;
     }
     return _ready;
 }
 
-loader::loader(std::string filename)
-    : _thread([this, filename]() { thread_proc(filename); }), 
-      _queue(1), _result()
+bool loader::poll()
+{
+    if (_polled || !ready()) return false;
+    _polled = true;
+    return true;
+}
+
+loader::loader(worker_pool& pool, std::string filename)
+    : _filename(filename)
 {
-}
\ No newline at end of file
+    _future = pool.submit([this, &pool, filename]() { return load(pool, filename, _progress); });
+}
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "util.h"
+#include "lod.h"
+#include "worker-pool.h"
 
 #include <vector>
-#include <thread>
-#include <readerwriterqueue.h>
+#include <atomic>
+#include <future>
+#include <memory>
 
 struct obj_mesh
 {
@@ -14,28 +17,60 @@ struct obj_mesh
     std::vector<float3> normals;
     std::vector<float2> uvs;
     std::vector<float3> tangents;
+    // Bitangent is tangent_signs[i] * cross(normal, tangent), empty means all +1
+    std::vector<float> tangent_signs;
 
-    void calculate_tangents();
+    // Large meshes are split across the pool when one is given
+    void calculate_tangents(worker_pool* pool = nullptr);
 };
 
 typedef std::vector<obj_mesh> obj_file;
 
+class mesh_cache;
+
+// Loads an OBJ file (or its mesh cache) as a job on a worker pool.
+// Results are picked up from the render thread, nothing here blocks
 class loader
 {
 public:
-    loader(std::string filename);
+    loader(worker_pool& pool, std::string filename);
 
     bool ready() const;
+    // Progress of the job in [0, 1], safe to read from any thread
+    float progress() const { return _progress; }
+    // True exactly once, the first time it is called after the job finished
+    bool poll();
+
+    int mesh_count() const;
+    // Mapped cache the meshes are served from, null if it could not be written.
+    // Only then are the parsed meshes kept in get()
+    const mesh_cache* cache() const;
     obj_file& get();
+    // Bounding sphere of every mesh, valid once ready
+    const std::vector<bounding_sphere>& bounds() const;
+    float get_load_time() const;
+
+    const std::string& filename() const { return _filename; }
 
     ~loader();
 
 private:
-    void thread_proc(std::string name);
+    loader(const loader& other) = delete;
+
+    struct result
+    {
+        std::shared_ptr<mesh_cache> cache;
+        obj_file meshes;
+        std::vector<bounding_sphere> bounds;
+        float load_time = 0.f;
+    };
+
+    static result load(worker_pool& pool, std::string name, std::atomic<float>& progress);
 
-    std::thread _thread;
-    mutable moodycamel::ReaderWriterQueue<obj_file> _queue;
-    mutable obj_file _result;
+    std::string _filename;
+    std::atomic<float> _progress{ 0.f };
+    mutable std::future<result> _future;
+    mutable result _result;
     mutable bool _ready = false;
-    float _progress = 0.f;
+    bool _polled = false;
 };
\ No newline at end of file
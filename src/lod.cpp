@@ -0,0 +1,45 @@
+#include "lod.h"
+#include "mesh.h"
+
+#include <algorithm>
+
+bounding_sphere calculate_bounding_sphere(const mesh_view& mesh)
+{
+    bounding_sphere res;
+    if (!mesh.vertex_count) return res;
+
+    auto first = mesh.positions, last = mesh.positions + mesh.vertex_count;
+
+    // Center of the axis-aligned box, good enough for the tube shapes
+    float3 lo = *first, hi = *first;
+    for (auto p = first; p != last; ++p)
+    {
+        lo = min(lo, *p);
+        hi = max(hi, *p);
+    }
+    res.center = (lo + hi) * 0.5f;
+
+    for (auto p = first; p != last; ++p)
+        res.radius = std::max(res.radius, distance(*p, res.center));
+
+    return res;
+}
+
+float projected_size(const bounding_sphere& sphere,
+    const float4x4& view, const float4x4& projection,
+    bool is_perspective, int viewport_height)
+{
+    auto size = 2.f * sphere.radius * projection[1][1] * 0.5f * viewport_height;
+    if (!is_perspective) return size;
+
+    auto depth = -mul(view, float4(sphere.center, 1.f)).z;
+    return size / std::max(depth, sphere.radius);
+}
+
+int lod_selector::select(float screen_size, int current) const
+{
+    int lod = std::max(0, std::min(current, levels() - 1));
+    while (lod < levels() - 1 && screen_size < _thresholds[lod] * (1.f - _hysteresis)) lod++;
+    while (lod > 0 && screen_size > _thresholds[lod - 1] * (1.f + _hysteresis)) lod--;
+    return lod;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "util.h"
+
+#include <vector>
+
+struct mesh_view;
+
+struct bounding_sphere
+{
+    float3 center{ 0.f, 0.f, 0.f };
+    float radius = 0.f;
+};
+
+bounding_sphere calculate_bounding_sphere(const mesh_view& mesh);
+
+// Approximate height in pixels of a sphere after projection
+float projected_size(const bounding_sphere& sphere,
+    const float4x4& view, const float4x4& projection,
+    bool is_perspective, int viewport_height);
+
+// Picks a level of detail from projected screen-space size.
+// thresholds[i] is the size (in pixels) below which level i + 1 is used instead of level i,
+// hysteresis widens every threshold around the current level to avoid popping
+class lod_selector
+{
+public:
+    lod_selector(std::vector<float> thresholds, float hysteresis = 0.15f)
+        : _thresholds(std::move(thresholds)), _hysteresis(hysteresis) {}
+
+    int select(float screen_size, int current) const;
+    int levels() const { return (int)_thresholds.size() + 1; }
+
+private:
+    std::vector<float> _thresholds;
+    float _hysteresis;
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "mapped-file.h"
+#include "util.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& filename)
+{
+    _file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+    {
+        _file = nullptr;
+        throw std::runtime_error(str() << "Could not open '" << filename << "'!");
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(_file, &size);
+    _size = (size_t)size.QuadPart;
+    if (_size == 0) return;
+
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping) _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!_data)
+    {
+        if (_mapping) CloseHandle(_mapping);
+        CloseHandle(_file);
+        throw std::runtime_error(str() << "Could not map '" << filename << "'!");
+    }
+}
+
+mapped_file::~mapped_file()
+{
+    if (_data) UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle(_mapping);
+    if (_file) CloseHandle(_file);
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& filename)
+{
+    _fd = open(filename.c_str(), O_RDONLY);
+    if (_fd < 0)
+        throw std::runtime_error(str() << "Could not open '" << filename << "'!");
+
+    struct stat st;
+    fstat(_fd, &st);
+    _size = (size_t)st.st_size;
+    if (_size == 0) return;
+
+    auto ptr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (ptr == MAP_FAILED)
+    {
+        close(_fd);
+        throw std::runtime_error(str() << "Could not map '" << filename << "'!");
+    }
+    madvise(ptr, _size, MADV_SEQUENTIAL);
+    _data = (const char*)ptr;
+}
+
+mapped_file::~mapped_file()
+{
+    if (_data) munmap((void*)_data, _size);
+    if (_fd >= 0) close(_fd);
+}
+
+#endif
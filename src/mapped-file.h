@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file
+class mapped_file
+{
+public:
+    explicit mapped_file(const std::string& filename);
+    ~mapped_file();
+
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    mapped_file(const mapped_file& other) = delete;
+    mapped_file& operator=(const mapped_file& other) = delete;
+
+    const char* _data = nullptr;
+    size_t _size = 0;
+
+#ifdef _WIN32
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+};
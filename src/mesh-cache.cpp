@@ -0,0 +1,263 @@
+#include "mesh-cache.h"
+#include "mapped-file.h"
+#include "mesh.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+    const char cache_magic[4] = { 'V', 'P', 'M', 'C' };
+    const uint32_t cache_version = 3;
+
+    struct cache_header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint32_t mesh_count;
+        uint32_t reserved;
+    };
+
+    enum layout_bits : uint32_t
+    {
+        has_uvs = 1,
+        has_normals = 2,
+        has_tangents = 4,
+        has_tangent_signs = 8,
+    };
+
+    // Block offsets are in bytes from the start of the file. Vertices are interleaved
+    // as described by the layout bits, indexes are uint16 or uint32 triplets
+    struct cache_entry
+    {
+        uint32_t name_offset, name_length;
+        uint32_t vertex_count, triangle_count;
+        float bounds[4]; // Bounding sphere center and radius
+        uint32_t layout, index_size;
+        uint64_t vertices, indexes;
+    };
+
+    static_assert(sizeof(cache_header) == 32, "Unexpected mesh cache header size");
+    static_assert(sizeof(cache_entry) == 56, "Unexpected mesh cache entry size");
+
+    uint64_t align(uint64_t offset)
+    {
+        return (offset + 15) & ~uint64_t(15);
+    }
+
+    uint32_t pack_layout(const vertex_layout& l)
+    {
+        uint32_t bits = 0;
+        if (l.uvs) bits |= has_uvs;
+        if (l.normals) bits |= has_normals;
+        if (l.tangents) bits |= has_tangents;
+        if (l.tangent_signs) bits |= has_tangent_signs;
+        return bits;
+    }
+
+    vertex_layout unpack_layout(uint32_t bits)
+    {
+        vertex_layout res;
+        res.uvs = (bits & has_uvs) != 0;
+        res.normals = (bits & has_normals) != 0;
+        res.tangents = (bits & has_tangents) != 0;
+        res.tangent_signs = res.tangents && (bits & has_tangent_signs) != 0;
+        return res;
+    }
+}
+
+std::string mesh_cache_path(const std::string& source)
+{
+    return source + ".cache";
+}
+
+mesh_cache::mesh_cache(std::unique_ptr<mapped_file> file)
+    : _file(std::move(file))
+{
+}
+
+mesh_cache::~mesh_cache() = default;
+
+std::shared_ptr<mesh_cache> mesh_cache::open(const std::string& source)
+{
+    auto path = mesh_cache_path(source);
+    uint64_t size;
+    int64_t mtime;
+    if (!file_exists(path) || !file_stamp(source, size, mtime)) return nullptr;
+
+    std::shared_ptr<mesh_cache> res(new mesh_cache(std::make_unique<mapped_file>(path)));
+    auto& file = *res->_file;
+    auto data = file.data();
+
+    cache_header header;
+    if (file.size() < sizeof(header)) return nullptr;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version ||
+        header.source_size != size ||
+        header.source_mtime != mtime)
+    {
+        return nullptr;
+    }
+
+    auto entries_end = sizeof(header) + (uint64_t)header.mesh_count * sizeof(cache_entry);
+    if (file.size() < entries_end) return nullptr;
+
+    for (uint32_t i = 0; i < header.mesh_count; i++)
+    {
+        cache_entry e;
+        memcpy(&e, data + sizeof(header) + i * sizeof(cache_entry), sizeof(e));
+
+        packed_mesh m;
+        m.layout = unpack_layout(e.layout);
+        m.vertex_count = (int)e.vertex_count;
+        m.triangle_count = (int)e.triangle_count;
+        m.short_indexes = e.index_size == sizeof(uint16_t);
+
+        auto vertex_bytes = (uint64_t)e.vertex_count * m.layout.stride() * sizeof(float);
+        auto index_bytes = (uint64_t)e.triangle_count * 3 * e.index_size;
+
+        // A truncated file is treated as a stale cache
+        auto fits = [&](uint64_t offset, uint64_t bytes) {
+            return offset + bytes <= file.size();
+        };
+        if ((e.index_size != sizeof(uint16_t) && e.index_size != sizeof(uint32_t)) ||
+            e.vertices % 16 || e.indexes % 16 ||
+            !fits(e.name_offset, e.name_length) ||
+            !fits(e.vertices, vertex_bytes) ||
+            !fits(e.indexes, index_bytes))
+        {
+            return nullptr;
+        }
+        m.vertices = reinterpret_cast<const float*>(data + e.vertices);
+        m.indexes = data + e.indexes;
+
+        bounding_sphere b;
+        b.center = { e.bounds[0], e.bounds[1], e.bounds[2] };
+        b.radius = e.bounds[3];
+
+        res->_meshes.push_back(m);
+        res->_names.emplace_back(data + e.name_offset, e.name_length);
+        res->_bounds.push_back(b);
+    }
+
+    return res;
+}
+
+bool write_mesh_cache(const std::string& source,
+    const obj_file& meshes, const std::vector<bounding_sphere>& bounds)
+{
+    cache_header header;
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.mesh_count = (uint32_t)meshes.size();
+    header.reserved = 0;
+    if (!file_stamp(source, header.source_size, header.source_mtime)) return false;
+
+    // Lay out names after the entries, then every block aligned
+    std::vector<cache_entry> entries(meshes.size());
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(cache_entry);
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        entries[i].name_offset = (uint32_t)offset;
+        entries[i].name_length = (uint32_t)meshes[i].name.size();
+        offset += meshes[i].name.size();
+    }
+
+    auto place = [&](size_t bytes) -> uint64_t {
+        if (!bytes) return 0;
+        offset = align(offset);
+        auto res = offset;
+        offset += bytes;
+        return res;
+    };
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        auto& m = meshes[i];
+        auto& e = entries[i];
+        auto layout = mesh_view(m).layout();
+
+        int max_index = 0;
+        for (auto& t : m.indexes)
+            max_index = std::max(max_index, std::max(t.x, std::max(t.y, t.z)));
+
+        e.vertex_count = (uint32_t)m.positions.size();
+        e.triangle_count = (uint32_t)m.indexes.size();
+        auto b = i < bounds.size() ? bounds[i] : calculate_bounding_sphere(m);
+        e.bounds[0] = b.center.x;
+        e.bounds[1] = b.center.y;
+        e.bounds[2] = b.center.z;
+        e.bounds[3] = b.radius;
+        e.layout = pack_layout(layout);
+        // Same narrowing rule as vbo::upload
+        e.index_size = max_index < 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+        e.vertices = place(m.positions.size() * layout.stride() * sizeof(float));
+        e.indexes = place(m.indexes.size() * 3 * e.index_size);
+    }
+
+    // Written to a temporary file first, so a crash never leaves a half written cache
+    auto path = mesh_cache_path(source);
+    auto temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+
+        uint64_t written = 0;
+        auto write = [&](const void* data, uint64_t at, size_t bytes) {
+            static const char zeros[16] = {};
+            while (written < at)
+            {
+                auto pad = std::min<uint64_t>(at - written, sizeof(zeros));
+                out.write(zeros, pad);
+                written += pad;
+            }
+            out.write((const char*)data, bytes);
+            written += bytes;
+        };
+
+        write(&header, 0, sizeof(header));
+        write(entries.data(), sizeof(header), entries.size() * sizeof(cache_entry));
+        for (size_t i = 0; i < meshes.size(); i++)
+            write(meshes[i].name.data(), entries[i].name_offset, meshes[i].name.size());
+
+        // Packed once here, so loading never has to
+        std::vector<float> vertices;
+        std::vector<uint16_t> short_indexes;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            auto& m = meshes[i];
+            auto& e = entries[i];
+            mesh_view view(m);
+
+            vertices.resize(m.positions.size() * view.layout().stride());
+            view.interleave(vertices.data());
+            if (e.vertices) write(vertices.data(), e.vertices, vertices.size() * sizeof(float));
+
+            if (!e.indexes) continue;
+            if (e.index_size == sizeof(uint32_t))
+            {
+                write(m.indexes.data(), e.indexes, m.indexes.size() * sizeof(int3));
+                continue;
+            }
+            short_indexes.clear();
+            for (auto& t : m.indexes)
+            {
+                short_indexes.push_back((uint16_t)t.x);
+                short_indexes.push_back((uint16_t)t.y);
+                short_indexes.push_back((uint16_t)t.z);
+            }
+            write(short_indexes.data(), e.indexes, short_indexes.size() * sizeof(uint16_t));
+        }
+
+        if (!out.good()) return false;
+    }
+
+    remove(path.c_str());
+    return rename(temp.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "loader.h"
+#include "lod.h"
+#include "mesh.h"
+
+#include <vector>
+#include <memory>
+
+class mapped_file;
+
+// Binary copy of loaded meshes stored next to the source file ("<source>.cache").
+// Every mesh is kept as the interleaved vertex stream and index block the vao 
+// uploads (16-byte aligned), so meshes go from the mapped file to the GPU 
+// without any copy. The cache is only used while the source file size and 
+// modification time match the ones it was written from
+std::string mesh_cache_path(const std::string& source);
+
+class mesh_cache
+{
+public:
+    // Null when there is no cache for the source or it is stale
+    static std::shared_ptr<mesh_cache> open(const std::string& source);
+
+    int size() const { return (int)_meshes.size(); }
+    // Points into the mapping, valid while the cache is alive
+    const packed_mesh& mesh(int i) const { return _meshes.at(i); }
+    const std::string& name(int i) const { return _names.at(i); }
+    const std::vector<bounding_sphere>& bounds() const { return _bounds; }
+
+    ~mesh_cache();
+
+private:
+    mesh_cache(const mesh_cache& other) = delete;
+    explicit mesh_cache(std::unique_ptr<mapped_file> file);
+
+    std::unique_ptr<mapped_file> _file;
+    std::vector<packed_mesh> _meshes;
+    std::vector<std::string> _names;
+    std::vector<bounding_sphere> _bounds;
+};
+
+// Returns false if the cache could not be written, loading still works without it
+bool write_mesh_cache(const std::string& source, 
+    const obj_file& meshes, const std::vector<bounding_sphere>& bounds);
@@ -0,0 +1,399 @@
+#include "mesh-optimizer.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+namespace
+{
+    struct vertex_key
+    {
+        float data[8];
+
+        bool operator==(const vertex_key& other) const
+        {
+            return memcmp(data, other.data, sizeof(data)) == 0;
+        }
+    };
+
+    struct vertex_key_hash
+    {
+        size_t operator()(const vertex_key& k) const
+        {
+            // FNV-1a over the raw bits
+            uint64_t h = 14695981039346656037ull;
+            auto bytes = reinterpret_cast<const uint8_t*>(k.data);
+            for (size_t i = 0; i < sizeof(k.data); i++)
+            {
+                h ^= bytes[i];
+                h *= 1099511628211ull;
+            }
+            return (size_t)h;
+        }
+    };
+}
+
+obj_mesh weld(const obj_mesh& mesh)
+{
+    obj_mesh res;
+    res.name = mesh.name;
+
+    const bool has_uvs = !mesh.uvs.empty();
+    const bool has_normals = !mesh.normals.empty();
+    const bool has_tangents = !mesh.tangents.empty();
+    const bool has_signs = !mesh.tangent_signs.empty();
+
+    auto n = mesh.positions.size();
+    res.positions.reserve(n);
+    if (has_uvs) res.uvs.reserve(n);
+    if (has_normals) res.normals.reserve(n);
+    if (has_tangents) res.tangents.reserve(n);
+    if (has_signs) res.tangent_signs.reserve(n);
+    res.indexes.reserve(mesh.indexes.size());
+
+    std::unordered_map<vertex_key, int, vertex_key_hash> cache;
+    cache.reserve(n);
+
+    // Walk the index buffer rather than the vertex arrays,
+    // so vertices no triangle references are dropped along the way
+    std::vector<int> remap(n, -1);
+    auto add_vertex = [&](int i) {
+        if (remap[i] >= 0) return remap[i];
+
+        vertex_key key;
+        memset(&key, 0, sizeof(key));
+        auto& p = mesh.positions[i];
+        key.data[0] = p.x; key.data[1] = p.y; key.data[2] = p.z;
+        if (has_normals)
+        {
+            auto& nr = mesh.normals[i];
+            key.data[3] = nr.x; key.data[4] = nr.y; key.data[5] = nr.z;
+        }
+        if (has_uvs)
+        {
+            auto& uv = mesh.uvs[i];
+            key.data[6] = uv.x; key.data[7] = uv.y;
+        }
+
+        auto it = cache.find(key);
+        if (it != cache.end()) return remap[i] = it->second;
+
+        int idx = res.positions.size();
+        cache.emplace(key, idx);
+
+        res.positions.push_back(p);
+        if (has_normals) res.normals.push_back(mesh.normals[i]);
+        if (has_uvs) res.uvs.push_back(mesh.uvs[i]);
+        if (has_tangents) res.tangents.push_back(mesh.tangents[i]);
+        if (has_signs) res.tangent_signs.push_back(mesh.tangent_signs[i]);
+        return remap[i] = idx;
+    };
+
+    for (auto& t : mesh.indexes)
+    {
+        auto x = add_vertex(t.x);
+        auto y = add_vertex(t.y);
+        auto z = add_vertex(t.z);
+        res.indexes.emplace_back(x, y, z);
+    }
+
+    return res;
+}
+
+namespace
+{
+    const int max_cache_size = 64;
+
+    float vertex_score(int cache_position, int remaining_triangles, int cache_size)
+    {
+        if (remaining_triangles == 0) return -1.f;
+
+        const float cache_decay_power = 1.5f;
+        const float last_triangle_score = 0.75f;
+        const float valence_boost_scale = 2.f;
+        const float valence_boost_power = 0.5f;
+
+        float score = 0.f;
+        if (cache_position >= 0)
+        {
+            if (cache_position < 3)
+            {
+                // The vertices of the triangle just emitted get a fixed score,
+                // so the optimizer does not simply keep re-using them
+                score = last_triangle_score;
+            }
+            else
+            {
+                const float scaler = 1.f / (cache_size - 3);
+                score = 1.f - (cache_position - 3) * scaler;
+                score = powf(score, cache_decay_power);
+            }
+        }
+
+        // Favour vertices with few triangles left, to finish them off
+        score += valence_boost_scale * powf((float)remaining_triangles, -valence_boost_power);
+        return score;
+    }
+}
+
+void optimize_vertex_cache(obj_mesh& mesh, int cache_size)
+{
+    cache_size = std::max(4, std::min(cache_size, max_cache_size));
+
+    const int vertex_count = mesh.positions.size();
+    const int triangle_count = mesh.indexes.size();
+    if (triangle_count == 0) return;
+
+    auto corner = [&](int t, int k) -> int {
+        auto& tri = mesh.indexes[t];
+        return k == 0 ? tri.x : (k == 1 ? tri.y : tri.z);
+    };
+
+    // Vertex -> triangles adjacency in a flat array
+    std::vector<int> offsets(vertex_count + 1, 0);
+    for (int t = 0; t < triangle_count; t++)
+        for (int k = 0; k < 3; k++) offsets[corner(t, k) + 1]++;
+    for (int v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+
+    std::vector<int> adjacency(offsets.back());
+    std::vector<int> remaining(vertex_count, 0);
+    for (int t = 0; t < triangle_count; t++)
+        for (int k = 0; k < 3; k++)
+        {
+            auto v = corner(t, k);
+            adjacency[offsets[v] + remaining[v]++] = t;
+        }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> score(vertex_count);
+    for (int v = 0; v < vertex_count; v++)
+        score[v] = vertex_score(-1, remaining[v], cache_size);
+
+    std::vector<bool> emitted(triangle_count, false);
+
+    std::vector<int3> result;
+    result.reserve(triangle_count);
+
+    // One extra slot for the three vertices pushed in by every emitted triangle
+    std::vector<int> cache, next_cache;
+    cache.reserve(cache_size + 3);
+    next_cache.reserve(cache_size + 3);
+
+    int best = -1;
+    float best_score = -1.f;
+    int scan = 0;
+
+    while ((int)result.size() < triangle_count)
+    {
+        if (best < 0)
+        {
+            // Nothing useful in the cache, fall back to the next unemitted triangle
+            while (scan < triangle_count && emitted[scan]) scan++;
+            if (scan == triangle_count) break;
+            best = scan;
+        }
+
+        emitted[best] = true;
+        result.push_back(mesh.indexes[best]);
+
+        // Remove the triangle from the adjacency of its vertices
+        for (int k = 0; k < 3; k++)
+        {
+            auto v = corner(best, k);
+            auto begin = adjacency.begin() + offsets[v];
+            auto end = begin + remaining[v];
+            auto it = std::find(begin, end, best);
+            std::iter_swap(it, end - 1);
+            remaining[v]--;
+        }
+
+        // Move the triangle's vertices to the front of the LRU cache
+        next_cache.clear();
+        for (int k = 0; k < 3; k++) next_cache.push_back(corner(best, k));
+        for (auto v : cache)
+            if (v != next_cache[0] && v != next_cache[1] && v != next_cache[2])
+                next_cache.push_back(v);
+
+        for (int i = 0; i < (int)next_cache.size(); i++)
+        {
+            auto v = next_cache[i];
+            cache_position[v] = i < cache_size ? i : -1;
+            score[v] = vertex_score(cache_position[v], remaining[v], cache_size);
+        }
+
+        if ((int)next_cache.size() > cache_size) next_cache.resize(cache_size);
+        std::swap(cache, next_cache);
+
+        // Only triangles touching the cache change score, pick the best of them
+        best = -1;
+        best_score = -1.f;
+        for (auto v : cache)
+        {
+            for (int i = offsets[v]; i < offsets[v] + remaining[v]; i++)
+            {
+                auto t = adjacency[i];
+                auto s = score[corner(t, 0)] + score[corner(t, 1)] + score[corner(t, 2)];
+                if (s > best_score)
+                {
+                    best_score = s;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    mesh.indexes = std::move(result);
+}
+
+vertex_cache_statistics analyze_vertex_cache(const obj_mesh& mesh, int cache_size)
+{
+    vertex_cache_statistics res;
+    if (mesh.indexes.empty() || mesh.positions.empty()) return res;
+
+    // Store the time each vertex entered the FIFO instead of shifting a queue
+    std::vector<int> timestamp(mesh.positions.size(), -cache_size - 1);
+    int time = 0;
+
+    auto fetch = [&](int v) {
+        if (time - timestamp[v] > cache_size)
+        {
+            timestamp[v] = time++;
+            res.misses++;
+        }
+    };
+
+    for (auto& t : mesh.indexes)
+    {
+        fetch(t.x);
+        fetch(t.y);
+        fetch(t.z);
+    }
+
+    res.acmr = (float)res.misses / mesh.indexes.size();
+    res.atvr = (float)res.misses / mesh.positions.size();
+    return res;
+}
+
+void optimize_overdraw(obj_mesh& mesh, int cache_size)
+{
+    const int triangle_count = mesh.indexes.size();
+    if (triangle_count == 0) return;
+
+    // Hard cluster boundaries: triangles with all three corners missing the cache
+    std::vector<int> clusters;
+    {
+        std::vector<int> timestamp(mesh.positions.size(), -cache_size - 1);
+        int time = 0;
+        auto fetch = [&](int v) {
+            if (time - timestamp[v] > cache_size)
+            {
+                timestamp[v] = time++;
+                return 1;
+            }
+            return 0;
+        };
+
+        for (int t = 0; t < triangle_count; t++)
+        {
+            auto& tri = mesh.indexes[t];
+            auto misses = fetch(tri.x) + fetch(tri.y) + fetch(tri.z);
+            if (t == 0 || misses == 3) clusters.push_back(t);
+        }
+    }
+    if (clusters.size() < 2) return;
+
+    float3 mesh_centroid{ 0.f, 0.f, 0.f };
+    for (auto& p : mesh.positions) mesh_centroid += p;
+    mesh_centroid = mesh_centroid / (float)mesh.positions.size();
+
+    struct cluster
+    {
+        int begin, end;
+        float sort_key;
+    };
+    std::vector<cluster> sorted;
+    sorted.reserve(clusters.size());
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        int begin = clusters[c];
+        int end = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+
+        float3 centroid{ 0.f, 0.f, 0.f };
+        float3 normal{ 0.f, 0.f, 0.f };
+        float area = 0.f;
+
+        for (int t = begin; t < end; t++)
+        {
+            auto& tri = mesh.indexes[t];
+            auto& a = mesh.positions[tri.x];
+            auto& b = mesh.positions[tri.y];
+            auto& cc = mesh.positions[tri.z];
+
+            auto n = cross(b - a, cc - a); // Length is twice the triangle area
+            auto w = length(n);
+            centroid += (a + b + cc) * (w / 3.f);
+            normal += n;
+            area += w;
+        }
+
+        float key = 0.f;
+        if (area > 0.f)
+        {
+            centroid = centroid / area;
+            auto nl = length(normal);
+            if (nl > 0.f) key = dot(centroid - mesh_centroid, normal / nl);
+        }
+        sorted.push_back({ begin, end, key });
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), 
+        [](const cluster& a, const cluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<int3> result;
+    result.reserve(triangle_count);
+    for (auto& c : sorted)
+        result.insert(result.end(), mesh.indexes.begin() + c.begin, mesh.indexes.begin() + c.end);
+
+    mesh.indexes = std::move(result);
+}
+
+void optimize_vertex_fetch(obj_mesh& mesh)
+{
+    const int vertex_count = mesh.positions.size();
+
+    std::vector<int> remap(vertex_count, -1);
+    int next = 0;
+    for (auto& t : mesh.indexes)
+    {
+        if (remap[t.x] < 0) remap[t.x] = next++;
+        if (remap[t.y] < 0) remap[t.y] = next++;
+        if (remap[t.z] < 0) remap[t.z] = next++;
+    }
+    for (auto& r : remap)
+        if (r < 0) r = next++;
+
+    auto reorder = [&](auto& attribute) {
+        if (attribute.empty()) return;
+        auto copy = attribute;
+        for (int i = 0; i < vertex_count; i++)
+            attribute[remap[i]] = copy[i];
+    };
+
+    reorder(mesh.positions);
+    reorder(mesh.normals);
+    reorder(mesh.uvs);
+    reorder(mesh.tangents);
+    reorder(mesh.tangent_signs);
+
+    for (auto& t : mesh.indexes)
+        t = { remap[t.x], remap[t.y], remap[t.z] };
+}
+
+void optimize_mesh(obj_mesh& mesh, bool reorder_vertices, int cache_size)
+{
+    optimize_vertex_cache(mesh, cache_size);
+    optimize_overdraw(mesh, cache_size);
+    if (reorder_vertices) optimize_vertex_fetch(mesh);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "util.h"
+#include "loader.h"
+
+// Merges vertices with bitwise identical position, normal and uv, and drops 
+// unreferenced ones, producing a properly indexed mesh. 
+// Tangents of the first occurrence are kept
+obj_mesh weld(const obj_mesh& mesh);
+
+// Reorders triangles to improve post-transform vertex cache hit rate
+// (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void optimize_vertex_cache(obj_mesh& mesh, int cache_size = 32);
+
+// Splits the cache-optimized triangle order into clusters at points where the
+// vertex cache is flushed anyway, and sorts clusters so outward facing ones come
+// first. Front-most surfaces are then drawn before what they occlude
+void optimize_overdraw(obj_mesh& mesh, int cache_size = 32);
+
+// Renumbers vertices in the order they are first referenced by the index buffer,
+// so vertex fetch walks memory linearly. Unreferenced vertices are moved to the end
+void optimize_vertex_fetch(obj_mesh& mesh);
+
+// Runs vertex cache, overdraw and (optionally) vertex fetch optimization.
+// Skip vertex reordering when vertex indices are stored elsewhere
+void optimize_mesh(obj_mesh& mesh, bool reorder_vertices = true, int cache_size = 32);
+
+struct vertex_cache_statistics
+{
+    int misses = 0;
+    float acmr = 0.f; // Average cache miss ratio: transformed vertices per triangle
+    float atvr = 0.f; // Average transform to vertex ratio: 1.0 is optimal
+};
+
+// Simulates a FIFO post-transform cache of the given size
+vertex_cache_statistics analyze_vertex_cache(const obj_mesh& mesh, int cache_size = 32);
@@ -0,0 +1,144 @@
+#include "mesh.h"
+
+#include <string.h>
+
+int vertex_layout::stride() const
+{
+    return 3 + (uvs ? 2 : 0) + (normals ? 3 : 0) + 
+        (tangents ? (tangent_signs ? 4 : 3) : 0);
+}
+
+int vertex_layout::offset(vertex_attribute attr) const
+{
+    int offset = 3;
+    switch (attr)
+    {
+    case vertex_attribute::position: return 0;
+    case vertex_attribute::uv:
+        return uvs ? offset : -1;
+    case vertex_attribute::normal:
+        if (uvs) offset += 2;
+        return normals ? offset : -1;
+    case vertex_attribute::tangent:
+        if (uvs) offset += 2;
+        if (normals) offset += 3;
+        return tangents ? offset : -1;
+    default: throw std::runtime_error("Unknown vertex attribute!");
+    }
+}
+
+mesh_view::mesh_view(const obj_mesh& mesh)
+    : positions(mesh.positions.data()),
+      uvs(mesh.uvs.empty() ? nullptr : mesh.uvs.data()),
+      normals(mesh.normals.empty() ? nullptr : mesh.normals.data()),
+      tangents(mesh.tangents.empty() ? nullptr : mesh.tangents.data()),
+      tangent_signs(mesh.tangents.empty() || mesh.tangent_signs.empty() ? 
+          nullptr : mesh.tangent_signs.data()),
+      indexes(mesh.indexes.data()),
+      vertex_count((int)mesh.positions.size()),
+      triangle_count((int)mesh.indexes.size())
+{
+}
+
+mesh_view::mesh_view(const mesh_arena& mesh)
+    : positions(mesh.positions()), uvs(mesh.uvs()), normals(mesh.normals()),
+      tangents(mesh.tangents()), tangent_signs(mesh.tangent_signs()),
+      indexes(mesh.indexes()),
+      vertex_count(mesh.vertex_count()), triangle_count(mesh.triangle_count())
+{
+}
+
+vertex_layout mesh_view::layout() const
+{
+    vertex_layout res;
+    res.uvs = uvs != nullptr;
+    res.normals = normals != nullptr;
+    res.tangents = tangents != nullptr;
+    res.tangent_signs = tangents != nullptr && tangent_signs != nullptr;
+    return res;
+}
+
+void mesh_view::interleave(float* dst) const
+{
+    auto l = layout();
+    auto stride = l.stride();
+
+    auto scatter = [&](vertex_attribute attr, const float* src, int size) {
+        if (!src) return;
+        float* out = dst + l.offset(attr);
+        for (int i = 0; i < vertex_count; i++)
+        {
+            for (int k = 0; k < size; k++) out[k] = src[k];
+            out += stride;
+            src += size;
+        }
+    };
+
+    scatter(vertex_attribute::position, (const float*)positions, 3);
+    scatter(vertex_attribute::uv, (const float*)uvs, 2);
+    scatter(vertex_attribute::normal, (const float*)normals, 3);
+    scatter(vertex_attribute::tangent, (const float*)tangents, 3);
+    if (l.tangent_signs)
+    {
+        float* out = dst + l.offset(vertex_attribute::tangent) + 3;
+        for (int i = 0; i < vertex_count; i++, out += stride) *out = tangent_signs[i];
+    }
+}
+
+mesh_arena::mesh_arena(int vertex_count, int triangle_count,
+    bool uvs, bool normals, bool tangents, bool tangent_signs)
+    : _vertex_count(vertex_count), _triangle_count(triangle_count)
+{
+    // Keep every block 16-byte aligned inside the arena
+    size_t total = 0;
+    auto reserve = [&](size_t bytes) {
+        auto offset = total;
+        total += (bytes + 15) & ~size_t(15);
+        return offset;
+    };
+
+    _positions = reserve(vertex_count * sizeof(float3));
+    if (uvs) _uvs = reserve(vertex_count * sizeof(float2));
+    if (normals) _normals = reserve(vertex_count * sizeof(float3));
+    if (tangents)
+    {
+        _tangents = reserve(vertex_count * sizeof(float3));
+        if (tangent_signs) _tangent_signs = reserve(vertex_count * sizeof(float));
+    }
+    _indexes = reserve(triangle_count * sizeof(int3));
+
+    _data.resize(total);
+}
+
+mesh_arena::mesh_arena(const obj_mesh& mesh)
+    : mesh_arena((int)mesh.positions.size(), (int)mesh.indexes.size(),
+                 !mesh.uvs.empty(), !mesh.normals.empty(), !mesh.tangents.empty(),
+                 !mesh.tangents.empty() && !mesh.tangent_signs.empty())
+{
+    auto copy = [](void* dst, const void* src, size_t bytes) {
+        if (dst && bytes) memcpy(dst, src, bytes);
+    };
+    copy(positions(), mesh.positions.data(), mesh.positions.size() * sizeof(float3));
+    copy(uvs(), mesh.uvs.data(), mesh.uvs.size() * sizeof(float2));
+    copy(normals(), mesh.normals.data(), mesh.normals.size() * sizeof(float3));
+    copy(tangents(), mesh.tangents.data(), mesh.tangents.size() * sizeof(float3));
+    copy(tangent_signs(), mesh.tangent_signs.data(), mesh.tangent_signs.size() * sizeof(float));
+    copy(indexes(), mesh.indexes.data(), mesh.indexes.size() * sizeof(int3));
+}
+
+vertex_layout mesh_arena::layout() const
+{
+    return mesh_view(*this).layout();
+}
+
+obj_mesh mesh_arena::to_obj_mesh() const
+{
+    obj_mesh res;
+    res.positions.assign(positions(), positions() + _vertex_count);
+    if (uvs()) res.uvs.assign(uvs(), uvs() + _vertex_count);
+    if (normals()) res.normals.assign(normals(), normals() + _vertex_count);
+    if (tangents()) res.tangents.assign(tangents(), tangents() + _vertex_count);
+    if (tangent_signs()) res.tangent_signs.assign(tangent_signs(), tangent_signs() + _vertex_count);
+    res.indexes.assign(indexes(), indexes() + _triangle_count);
+    return res;
+}
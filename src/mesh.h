@@ -0,0 +1,124 @@
+#pragma once
+
+#include "util.h"
+#include "loader.h"
+
+#include <vector>
+
+// Attribute slots, matching the layout(location = N) of the vertex shader inputs
+enum class vertex_attribute
+{
+    position = 0,
+    uv = 1,
+    normal = 2,
+    tangent = 3,
+};
+
+// Attributes of a mesh and how they are interleaved for upload. Stride and
+// offsets are in floats. Tangent signs, when present, follow the tangent as its
+// fourth component
+struct vertex_layout
+{
+    bool uvs = false, normals = false, tangents = false, tangent_signs = false;
+
+    int stride() const;
+    // Negative for attributes the layout does not have
+    int offset(vertex_attribute attr) const;
+    bool has(vertex_attribute attr) const { return offset(attr) >= 0; }
+};
+
+class mesh_arena;
+
+// Non-owning view of the attribute arrays of a mesh, so meshes held in
+// any container upload without an intermediate copy
+struct mesh_view
+{
+    const float3* positions = nullptr;
+    const float2* uvs = nullptr;
+    const float3* normals = nullptr;
+    const float3* tangents = nullptr;
+    const float* tangent_signs = nullptr;
+    const int3* indexes = nullptr;
+    int vertex_count = 0, triangle_count = 0;
+
+    mesh_view() {}
+    mesh_view(const obj_mesh& mesh);
+    mesh_view(const mesh_arena& mesh);
+
+    vertex_layout layout() const;
+
+    // Writes vertex_count * layout().stride() floats
+    void interleave(float* dst) const;
+};
+
+// Vertices already interleaved in the full vertex format and indexes in
+// their GPU width, e.g. pointing into a mapped mesh cache
+struct packed_mesh
+{
+    const float* vertices = nullptr;
+    const void* indexes = nullptr;
+    int vertex_count = 0, triangle_count = 0;
+    vertex_layout layout;
+    bool short_indexes = false;
+};
+
+// Mesh storage that keeps all vertex attributes and indexes in a single
+// allocation. Attributes are laid out as consecutive arrays (SoA) for
+// CPU-side processing, mesh_view interleaves them for upload
+class mesh_arena
+{
+public:
+    mesh_arena() {}
+    mesh_arena(int vertex_count, int triangle_count,
+        bool uvs = true, bool normals = true, bool tangents = true,
+        bool tangent_signs = false);
+    explicit mesh_arena(const obj_mesh& mesh);
+
+    mesh_arena(mesh_arena&& other) = default;
+    mesh_arena& operator=(mesh_arena&& other) = default;
+
+    float3* positions() { return block<float3>(_positions); }
+    float2* uvs() { return block<float2>(_uvs); }
+    float3* normals() { return block<float3>(_normals); }
+    float3* tangents() { return block<float3>(_tangents); }
+    float* tangent_signs() { return block<float>(_tangent_signs); }
+    int3* indexes() { return block<int3>(_indexes); }
+
+    const float3* positions() const { return block<float3>(_positions); }
+    const float2* uvs() const { return block<float2>(_uvs); }
+    const float3* normals() const { return block<float3>(_normals); }
+    const float3* tangents() const { return block<float3>(_tangents); }
+    const float* tangent_signs() const { return block<float>(_tangent_signs); }
+    const int3* indexes() const { return block<int3>(_indexes); }
+
+    int vertex_count() const { return _vertex_count; }
+    int triangle_count() const { return _triangle_count; }
+
+    bool has(vertex_attribute attr) const { return layout().has(attr); }
+    bool has_tangent_signs() const { return _tangent_signs != npos; }
+
+    vertex_layout layout() const;
+
+    size_t size_bytes() const { return _data.size(); }
+
+    obj_mesh to_obj_mesh() const;
+
+private:
+    mesh_arena(const mesh_arena& other) = delete;
+
+    template<class T> T* block(size_t offset)
+    {
+        return offset == npos ? nullptr : reinterpret_cast<T*>(_data.data() + offset);
+    }
+    template<class T> const T* block(size_t offset) const
+    {
+        return offset == npos ? nullptr : reinterpret_cast<const T*>(_data.data() + offset);
+    }
+
+    static const size_t npos = (size_t)-1;
+
+    std::vector<uint8_t> _data;
+    int _vertex_count = 0, _triangle_count = 0;
+    size_t _positions = npos, _uvs = npos, _normals = npos,
+           _tangents = npos, _tangent_signs = npos, _indexes = npos;
+};
@@ -0,0 +1,281 @@
+#include "mip-chain.h"
+#include "util.h"
+
+#include <algorithm>
+#include <vector>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_CHAIN_SSE2
+#endif
+
+namespace
+{
+    // Every texel is held as four floats so one texel is one SSE register
+    typedef std::vector<float> float_image;
+
+    const float* srgb_to_linear_table()
+    {
+        static const std::vector<float> table = []() {
+            std::vector<float> t(256);
+            for (int i = 0; i < 256; i++)
+            {
+                auto c = i / 255.f;
+                t[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // Indexed by linear value * 65535, fine enough to resolve the darkest sRGB steps
+    const uint8_t* linear_to_srgb_table()
+    {
+        static const std::vector<uint8_t> table = []() {
+            std::vector<uint8_t> t(65536);
+            for (int i = 0; i < 65536; i++)
+            {
+                auto c = i / 65535.f;
+                c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.f / 2.4f) - 0.055f;
+                t[i] = (uint8_t)std::min(255.f, c * 255.f + 0.5f);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // Per output texel, the source texels and weights along one axis
+    struct filter_table
+    {
+        int taps = 0;
+        std::vector<int> indexes;
+        std::vector<float> weights;
+    };
+
+    float kaiser_weight(float t)
+    {
+        const float radius = 1.5f; // In output texels
+        const float alpha = 4.f;
+        if (fabsf(t) >= radius) return 0.f;
+
+        auto bessel_i0 = [](float x) {
+            float sum = 1.f, term = 1.f;
+            for (int k = 1; k < 16; k++)
+            {
+                term *= (x / (2.f * k)) * (x / (2.f * k));
+                sum += term;
+            }
+            return sum;
+        };
+        auto sinc = t == 0.f ? 1.f : sinf(3.14159265f * t) / (3.14159265f * t);
+        auto r = t / radius;
+        return sinc * bessel_i0(alpha * sqrtf(1.f - r * r)) / bessel_i0(alpha);
+    }
+
+    filter_table make_filter(int src, int dst, mip_filter filter)
+    {
+        auto scale = (float)src / dst;
+        auto radius = (filter == mip_filter::box ? 0.5f : 1.5f) * scale;
+
+        filter_table res;
+        res.taps = (int)ceilf(radius * 2.f) + 1;
+        res.indexes.resize(dst * res.taps);
+        res.weights.resize(dst * res.taps);
+
+        std::vector<float> w(res.taps);
+        for (int x = 0; x < dst; x++)
+        {
+            auto center = (x + 0.5f) * scale; // In source texel edges
+            auto first = (int)floorf(center - radius);
+
+            float total = 0.f;
+            for (int k = 0; k < res.taps; k++)
+            {
+                auto t = (first + k + 0.5f - center) / scale;
+                w[k] = filter == mip_filter::box 
+                    ? (fabsf(t) < 0.5f ? 1.f : 0.f)
+                    : kaiser_weight(t);
+                total += w[k];
+            }
+
+            for (int k = 0; k < res.taps; k++)
+            {
+                // Clamp to edge: texels past the border reuse the last one
+                res.indexes[x * res.taps + k] = std::max(0, std::min(src - 1, first + k));
+                res.weights[x * res.taps + k] = total != 0.f ? w[k] / total : 0.f;
+            }
+        }
+        return res;
+    }
+
+    // Filters one row: out[i] = sum of weights[k] * in[indexes[k]]
+    void resample_row(const float* in, float* out, int count, const filter_table& f)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            auto idx = f.indexes.data() + i * f.taps;
+            auto w = f.weights.data() + i * f.taps;
+#ifdef MIP_CHAIN_SSE2
+            auto acc = _mm_setzero_ps();
+            for (int k = 0; k < f.taps; k++)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(in + idx[k] * 4)));
+            _mm_storeu_ps(out + i * 4, acc);
+#else
+            float acc[4] = {};
+            for (int k = 0; k < f.taps; k++)
+            {
+                auto p = in + idx[k] * 4;
+                for (int c = 0; c < 4; c++) acc[c] += w[k] * p[c];
+            }
+            memcpy(out + i * 4, acc, sizeof(acc));
+#endif
+        }
+    }
+
+    // out += w * in, over whole rows so the vertical pass walks memory linearly
+    void accumulate_row(const float* in, float* out, size_t floats, float w)
+    {
+        size_t i = 0;
+#ifdef MIP_CHAIN_SSE2
+        auto ww = _mm_set1_ps(w);
+        for (; i + 4 <= floats; i += 4)
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(ww, _mm_loadu_ps(in + i))));
+#endif
+        for (; i < floats; i++) out[i] += w * in[i];
+    }
+
+    // source_row(y) returns row y of the source level as float texels
+    template<class F>
+    void downsample(F source_row, int sw, int sh, 
+        float_image& dst, int dw, int dh, mip_filter filter)
+    {
+        auto fx = make_filter(sw, dw, filter);
+        auto fy = make_filter(sh, dh, filter);
+
+        // Horizontal pass first, it shrinks the image the vertical pass walks
+        float_image temp((size_t)dw * sh * 4);
+        for (int y = 0; y < sh; y++)
+            resample_row(source_row(y), temp.data() + (size_t)y * dw * 4, dw, fx);
+
+        const size_t row = (size_t)dw * 4;
+        dst.assign(row * dh, 0.f);
+        for (int y = 0; y < dh; y++)
+        {
+            for (int k = 0; k < fy.taps; k++)
+            {
+                auto w = fy.weights[y * fy.taps + k];
+                if (w == 0.f) continue;
+                accumulate_row(temp.data() + fy.indexes[y * fy.taps + k] * row, dst.data() + y * row, row, w);
+            }
+        }
+    }
+
+    void renormalize(float_image& img)
+    {
+        for (size_t i = 0; i < img.size(); i += 4)
+        {
+            auto n = float3{ img[i], img[i + 1], img[i + 2] };
+            auto l = length(n);
+            if (l > 1e-6f) n = n / l;
+            else n = { 0.f, 0.f, 1.f };
+            img[i] = n.x;
+            img[i + 1] = n.y;
+            img[i + 2] = n.z;
+        }
+    }
+
+    void to_float(const uint8_t* pixels, size_t count, int channels, 
+        texture_usage usage, float* out)
+    {
+        auto srgb = srgb_to_linear_table();
+        auto color = std::min(channels, 3);
+        memset(out, 0, count * 4 * sizeof(float));
+        for (size_t i = 0; i < count; i++)
+        {
+            auto p = pixels + i * channels;
+            auto o = out + i * 4;
+            for (int c = 0; c < channels; c++)
+            {
+                if (c >= color) o[c] = p[c] / 255.f;
+                else if (usage == texture_usage::normal_map) o[c] = p[c] / 127.5f - 1.f;
+                else o[c] = srgb[p[c]];
+            }
+        }
+    }
+
+    void to_bytes(const float_image& img, size_t count, int channels, 
+        texture_usage usage, uint8_t* out)
+    {
+        auto srgb = linear_to_srgb_table();
+        auto color = std::min(channels, 3);
+        auto quantize = [](float v, float scale) {
+            return std::max(0, std::min((int)(v * scale + 0.5f), (int)scale));
+        };
+        for (size_t i = 0; i < count; i++)
+        {
+            auto p = img.data() + i * 4;
+            auto o = out + i * channels;
+            for (int c = 0; c < channels; c++)
+            {
+                if (c >= color) o[c] = (uint8_t)quantize(p[c], 255.f);
+                else if (usage == texture_usage::normal_map) o[c] = (uint8_t)quantize((p[c] + 1.f) * 0.5f, 255.f);
+                else o[c] = srgb[quantize(p[c], 65535.f)];
+            }
+        }
+    }
+}
+
+texture_image build_mip_chain(const uint8_t* pixels, int width, int height, int channels,
+    texture_usage usage, mip_filter filter)
+{
+    texture_image res;
+    res.format = format_for_channels(channels);
+    if (channels < 3) usage = texture_usage::color;
+
+    // Sizes are known up front, so every level is written straight into place
+    size_t total = 0;
+    for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+    {
+        mip_level l;
+        l.width = w;
+        l.height = h;
+        l.offset = total;
+        res.levels.push_back(l);
+        total += level_size(res.format, w, h);
+        if (w == 1 && h == 1) break;
+    }
+    res.data.resize(total);
+    memcpy(res.data.data(), pixels, level_size(res.format, width, height));
+
+    // Each level is filtered from the previous one in float, so rounding does not accumulate.
+    // The first level is converted a row at a time as it is read
+    float_image current, next, row(width * 4);
+
+    for (size_t i = 1; i < res.levels.size(); i++)
+    {
+        auto& src = res.levels[i - 1];
+        auto& dst = res.levels[i];
+
+        if (i == 1)
+        {
+            downsample([&](int y) {
+                to_float(pixels + (size_t)y * width * channels, width, channels, usage, row.data());
+                return row.data();
+            }, src.width, src.height, next, dst.width, dst.height, filter);
+        }
+        else
+        {
+            downsample([&](int y) {
+                return current.data() + (size_t)y * src.width * 4;
+            }, src.width, src.height, next, dst.width, dst.height, filter);
+        }
+        if (usage == texture_usage::normal_map) renormalize(next);
+
+        to_bytes(next, (size_t)dst.width * dst.height, channels, usage, res.data.data() + dst.offset);
+        std::swap(current, next);
+    }
+
+    return res;
+}
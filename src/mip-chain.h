@@ -0,0 +1,16 @@
+#pragma once
+
+#include "texture.h"
+
+enum class mip_filter
+{
+    box,    // 2x2 average, cheapest
+    kaiser, // Kaiser windowed sinc over 6x6 texels, keeps lower levels sharper
+};
+
+// Builds the full mip pyramid of an 8-bit image, down to 1x1.
+// Colour channels are filtered in linear space (sources are treated as sRGB), 
+// alpha as is. Normal map texels are filtered as vectors and renormalized on every level.
+// Odd sizes are resampled rather than truncated, so no texel row is dropped
+texture_image build_mip_chain(const uint8_t* pixels, int width, int height, int channels,
+    texture_usage usage = texture_usage::color, mip_filter filter = mip_filter::kaiser);
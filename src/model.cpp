@@ -29,13 +29,7 @@ void model::create(obj_file& loader)
                 p.z /= _max;
             }
 
-            _geometry = std::make_shared<vao>(mesh.positions.data(),
-                mesh.uvs.data(),
-                mesh.normals.data(), 
-                mesh.tangents.data(),
-                mesh.positions.size(), 
-                mesh.indexes.data(), 
-                mesh.indexes.size());
+            _geometry = vao::create(mesh);
         }
     }
 }
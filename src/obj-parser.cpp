@@ -0,0 +1,397 @@
+#include "obj-parser.h"
+#include "mapped-file.h"
+#include "worker-pool.h"
+
+#include <thread>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+namespace
+{
+    bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+    bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    const char* skip_space(const char* p, const char* end)
+    {
+        while (p < end && is_space(*p)) p++;
+        return p;
+    }
+
+    const char* next_line(const char* p, const char* end)
+    {
+        auto nl = (const char*)memchr(p, '\n', end - p);
+        return nl ? nl + 1 : end;
+    }
+
+    // Decimal mantissa and exponent are collected as integers 
+    // and combined once, instead of going through std::stof
+    const char* parse_float(const char* p, const char* end, float& out)
+    {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        p = skip_space(p, end);
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+        uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        auto digit = [&](int d, bool fraction) {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + d;
+                if (mantissa) digits++;
+                if (fraction) exponent--;
+            }
+            else if (!fraction) exponent++;
+        };
+
+        while (p < end && is_digit(*p)) digit(*p++ - '0', false);
+        if (p < end && *p == '.')
+        {
+            p++;
+            while (p < end && is_digit(*p)) digit(*p++ - '0', true);
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            bool negative_exp = false;
+            if (p < end && (*p == '-' || *p == '+')) negative_exp = *p++ == '-';
+            int e = 0;
+            while (p < end && is_digit(*p)) e = std::min(e * 10 + (*p++ - '0'), 10000);
+            exponent += negative_exp ? -e : e;
+        }
+
+        double value = (double)mantissa;
+        if (exponent < 0)
+            value = -exponent <= 22 ? value / powers[-exponent] : value * pow(10.0, exponent);
+        else if (exponent > 0)
+            value = exponent <= 22 ? value * powers[exponent] : value * pow(10.0, exponent);
+
+        out = (float)(negative ? -value : value);
+        return p;
+    }
+
+    const char* parse_int(const char* p, const char* end, int& out)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+        int value = 0;
+        while (p < end && is_digit(*p)) value = value * 10 + (*p++ - '0');
+        out = negative ? -value : value;
+        return p;
+    }
+
+    enum class line_type
+    {
+        position,
+        uv,
+        normal,
+        face,
+        object,
+        material,
+        other
+    };
+
+    const int attribute_kinds = 3; // position, uv, normal
+
+    // Identifies the statement and moves p past its keyword
+    line_type classify(const char*& p, const char* end)
+    {
+        p = skip_space(p, end);
+        auto keyword = p;
+        while (p < end && !is_space(*p) && *p != '\n') p++;
+        auto length = p - keyword;
+
+        auto is = [&](const char* k) {
+            return length == (long)strlen(k) && memcmp(keyword, k, length) == 0;
+        };
+
+        if (is("v")) return line_type::position;
+        if (is("vt")) return line_type::uv;
+        if (is("vn")) return line_type::normal;
+        if (is("f")) return line_type::face;
+        if (is("o") || is("g")) return line_type::object;
+        if (is("usemtl")) return line_type::material;
+        return line_type::other;
+    }
+
+    std::string rest_of_line(const char* p, const char* end)
+    {
+        p = skip_space(p, end);
+        auto e = p;
+        while (e < end && *e != '\n') e++;
+        while (e > p && is_space(e[-1])) e--;
+        return std::string(p, e);
+    }
+
+    struct boundary
+    {
+        int face;       // Local index of the first face after the statement
+        bool material;  // usemtl, otherwise o / g
+        std::string name;
+    };
+
+    struct chunk
+    {
+        const char* begin;
+        const char* end;
+
+        int counts[attribute_kinds] = { 0, 0, 0 };
+        int bases[attribute_kinds] = { 0, 0, 0 };
+
+        std::vector<int3> corners;     // Global position, uv, normal index, -1 if missing
+        std::vector<int> face_offsets; // First corner of every face, plus one past the end
+        std::vector<boundary> boundaries;
+    };
+
+    void count_attributes(chunk& c)
+    {
+        for (auto p = c.begin; p < c.end; p = next_line(p, c.end))
+        {
+            auto type = classify(p, c.end);
+            if (type == line_type::position) c.counts[0]++;
+            else if (type == line_type::uv) c.counts[1]++;
+            else if (type == line_type::normal) c.counts[2]++;
+        }
+    }
+
+    void parse_chunk(chunk& c, 
+        std::vector<float3>& positions, 
+        std::vector<float2>& uvs, 
+        std::vector<float3>& normals)
+    {
+        int local[attribute_kinds] = { 0, 0, 0 };
+        c.face_offsets.push_back(0);
+
+        // Negative indices are relative to the attributes read so far
+        auto resolve = [&](int idx, int kind) {
+            if (idx > 0) return idx - 1;
+            if (idx < 0) return c.bases[kind] + local[kind] + idx;
+            return -1;
+        };
+
+        for (auto p = c.begin; p < c.end; p = next_line(p, c.end))
+        {
+            switch (classify(p, c.end))
+            {
+            case line_type::position:
+            {
+                auto& v = positions[c.bases[0] + local[0]++];
+                p = parse_float(p, c.end, v.x);
+                p = parse_float(p, c.end, v.y);
+                p = parse_float(p, c.end, v.z);
+                break;
+            }
+            case line_type::uv:
+            {
+                auto& v = uvs[c.bases[1] + local[1]++];
+                p = parse_float(p, c.end, v.x);
+                p = parse_float(p, c.end, v.y);
+                break;
+            }
+            case line_type::normal:
+            {
+                auto& v = normals[c.bases[2] + local[2]++];
+                p = parse_float(p, c.end, v.x);
+                p = parse_float(p, c.end, v.y);
+                p = parse_float(p, c.end, v.z);
+                break;
+            }
+            case line_type::face:
+            {
+                auto first = c.corners.size();
+                while (true)
+                {
+                    p = skip_space(p, c.end);
+                    if (p >= c.end || !(is_digit(*p) || *p == '-' || *p == '+')) break;
+
+                    int v = 0, vt = 0, vn = 0;
+                    p = parse_int(p, c.end, v);
+                    if (p < c.end && *p == '/')
+                    {
+                        p++;
+                        if (p < c.end && *p != '/') p = parse_int(p, c.end, vt);
+                        if (p < c.end && *p == '/') p = parse_int(p + 1, c.end, vn);
+                    }
+                    c.corners.emplace_back(resolve(v, 0), resolve(vt, 1), resolve(vn, 2));
+                }
+
+                // Lines and points are not meshes
+                if (c.corners.size() - first < 3) c.corners.resize(first);
+                else c.face_offsets.push_back(c.corners.size());
+                break;
+            }
+            case line_type::object:
+                c.boundaries.push_back({ (int)c.face_offsets.size() - 1, false, rest_of_line(p, c.end) });
+                break;
+            case line_type::material:
+                c.boundaries.push_back({ (int)c.face_offsets.size() - 1, true, rest_of_line(p, c.end) });
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // Consecutive faces of one chunk that end up in the same mesh
+    struct segment
+    {
+        int chunk;
+        int first_face, last_face;
+        int mesh;
+        int first_vertex, first_triangle;
+    };
+}
+
+obj_file parse_obj(worker_pool& pool, const std::string& filename, std::function<void(float)> progress)
+{
+    mapped_file file(filename);
+    const char* data = file.data();
+    const char* end = data + file.size();
+
+    // Line-aligned chunks, a few per thread to balance uneven content
+    const size_t min_chunk = 256 * 1024;
+    auto max_chunks = (pool.size() + 1) * 4;
+    auto chunk_count = std::max(1, std::min(max_chunks, (int)(file.size() / min_chunk)));
+
+    std::vector<chunk> chunks;
+    auto p = data;
+    for (int i = 0; i < chunk_count && p < end; i++)
+    {
+        auto split = i == chunk_count - 1 ? end : data + file.size() * (i + 1) / chunk_count;
+        split = std::max(split, p);
+        if (split < end) split = next_line(split, end);
+
+        chunk c;
+        c.begin = p;
+        c.end = split;
+        chunks.push_back(c);
+        p = split;
+    }
+
+    // Pass 1: count attributes, so every chunk knows where its vertices go
+    run_parallel(pool, (int)chunks.size(), [&](int i) { count_attributes(chunks[i]); },
+        [&](float f) { progress(f * 0.2f); });
+
+    int totals[attribute_kinds] = { 0, 0, 0 };
+    for (auto& c : chunks)
+        for (int k = 0; k < attribute_kinds; k++)
+        {
+            c.bases[k] = totals[k];
+            totals[k] += c.counts[k];
+        }
+
+    std::vector<float3> positions(totals[0]);
+    std::vector<float2> uvs(totals[1], { 0.f, 0.f });
+    std::vector<float3> normals(totals[2]);
+
+    // Pass 2: parse attributes in place and collect faces
+    run_parallel(pool, (int)chunks.size(), 
+        [&](int i) { parse_chunk(chunks[i], positions, uvs, normals); },
+        [&](float f) { progress(0.2f + f * 0.6f); });
+
+    // Split faces into meshes, the bookkeeping is per face only
+    obj_file result;
+    std::vector<segment> segments;
+    std::vector<int> vertex_counts, triangle_counts;
+    std::string name;
+
+    auto open_mesh = [&]() {
+        obj_mesh m;
+        m.name = name;
+        result.push_back(m);
+        vertex_counts.push_back(0);
+        triangle_counts.push_back(0);
+    };
+    auto mesh_has_faces = [&]() {
+        return !result.empty() && triangle_counts.back() > 0;
+    };
+    auto add_faces = [&](int ci, int first, int last) {
+        if (first == last) return;
+        if (result.empty()) open_mesh();
+
+        auto& c = chunks[ci];
+        auto corners = c.face_offsets[last] - c.face_offsets[first];
+        auto mesh = (int)result.size() - 1;
+        segments.push_back({ ci, first, last, mesh, vertex_counts[mesh], triangle_counts[mesh] });
+        vertex_counts[mesh] += corners;
+        triangle_counts[mesh] += corners - 2 * (last - first);
+    };
+
+    for (int ci = 0; ci < (int)chunks.size(); ci++)
+    {
+        auto& c = chunks[ci];
+        int face = 0;
+        for (auto& b : c.boundaries)
+        {
+            add_faces(ci, face, b.face);
+            face = b.face;
+
+            if (!b.material) name = b.name;
+            if (mesh_has_faces()) open_mesh();
+            else if (!result.empty()) result.back().name = name;
+        }
+        add_faces(ci, face, (int)c.face_offsets.size() - 1);
+    }
+
+    if (!result.empty() && !mesh_has_faces()) result.pop_back();
+    for (int m = 0; m < (int)result.size(); m++)
+    {
+        result[m].positions.resize(vertex_counts[m]);
+        result[m].uvs.resize(vertex_counts[m]);
+        result[m].normals.resize(vertex_counts[m]);
+        result[m].indexes.resize(triangle_counts[m]);
+    }
+
+    // Pass 3: every segment writes its own range of the output meshes
+    run_parallel(pool, (int)segments.size(), [&](int si) {
+        auto& s = segments[si];
+        auto& c = chunks[s.chunk];
+        auto& mesh = result[s.mesh];
+
+        auto fetch = [&](int idx, int count) {
+            if (idx < 0 || idx >= count)
+                throw std::runtime_error(str() << "Invalid index in '" << filename << "'!");
+            return idx;
+        };
+
+        int vertex = s.first_vertex;
+        int triangle = s.first_triangle;
+        for (int f = s.first_face; f < s.last_face; f++)
+        {
+            auto first = c.face_offsets[f];
+            auto count = c.face_offsets[f + 1] - first;
+
+            bool missing_normal = false;
+            for (int k = 0; k < count; k++)
+            {
+                auto& corner = c.corners[first + k];
+                mesh.positions[vertex + k] = positions[fetch(corner.x, totals[0])];
+                mesh.uvs[vertex + k] = corner.y < 0 ? float2{ 0.f, 0.f } : uvs[fetch(corner.y, totals[1])];
+                if (corner.z < 0) missing_normal = true;
+                else mesh.normals[vertex + k] = normals[fetch(corner.z, totals[2])];
+            }
+
+            if (missing_normal)
+            {
+                auto p = mesh.positions.data() + vertex;
+                auto normal = cross(p[0] - p[1], p[2] - p[1]);
+                for (int k = 0; k < count; k++) mesh.normals[vertex + k] = normal;
+            }
+
+            for (int k = 1; k + 1 < count; k++)
+                mesh.indexes[triangle++] = { vertex, vertex + k, vertex + k + 1 };
+
+            vertex += count;
+        }
+    }, [&](float f) { progress(0.8f + f * 0.2f); });
+
+    progress(1.f);
+    return result;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "loader.h"
+#include "worker-pool.h"
+
+#include <functional>
+
+// Wavefront OBJ reader. The file is memory mapped and split into line-aligned
+// chunks that are parsed in parallel on the pool straight into the final vertex streams.
+// Like objl::Loader, meshes are split on o / g / usemtl, every face corner becomes
+// its own vertex, and corners without a normal get the face normal.
+// Polygons are triangulated as fans, so they are expected to be convex
+obj_file parse_obj(worker_pool& pool, const std::string& filename, 
+    std::function<void(float)> progress = [](float) {});
@@ -6,9 +6,12 @@
 
 #include <easylogging++.h>
 
+#include "mesh-optimizer.h"
+
 #include "VoronoiDiagramGenerator.h"
 
 #include <random>
+#include <memory>
 
 bool sitesOrdered(const Point2& s1, const Point2& s2) {
     if (s1.y < s2.y)
@@ -32,28 +35,26 @@ float dist(const Point2& p)
     return std::min(dist(p[0]), dist(p[1]));
 }
 
-std::default_random_engine generator;
-
 void generate_broken_glass(
-    std::vector<glass_peice>& peices)
+    std::vector<glass_peice>& peices,
+    std::default_random_engine& generator,
+    bool welded)
 {
-    obj_mesh res;
+    std::normal_distribution<float> distribution(0.5f, 0.2f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::uniform_int_distribution<int> sites_count(20, 49);
 
-    //unsigned int dimension = 1000000;
-    int numSites = rand() % 30 + 20;
+    int numSites = sites_count(generator);
 
     BoundingBox bbox(-1, 2, 2, -1);
 
     std::vector<Point2> tmpSites, sites;
 
-    tmpSites.reserve(numSites);
-    sites.reserve(numSites);
+    tmpSites.reserve(6 * numSites);
+    sites.reserve(6 * numSites);
 
     Point2 s;
 
-    std::normal_distribution<float> distribution(0.5f, 0.2f);
-    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
-
     for (unsigned int i = 0; i < 4 * numSites; ++i) {
         s.x = uniform(generator) * 3.f - 1.f;
         s.y = uniform(generator) * 3.f - 1.f;
@@ -79,8 +80,12 @@ void generate_broken_glass(
         if (s != sites.back()) sites.push_back(s);
     }
 
+    // Diagram owns all the cells, edges and vertices through its memory pools,
+    // releasing it here keeps repeated generation from leaking
     VoronoiDiagramGenerator gen;
-    auto diagram = gen.compute(sites, bbox);
+    std::unique_ptr<Diagram> diagram(gen.compute(sites, bbox));
+
+    peices.reserve(peices.size() + diagram->cells.size());
 
     for (Cell* c : diagram->cells) 
     {
@@ -113,8 +118,22 @@ void generate_broken_glass(
             }
         }
 
+        if (k == 0) continue;
+
         pos = pos * (1.f / k);
 
+        // Every closed half-edge produces either a full prism segment 
+        // (12 vertices, 4 triangles) or a single flat triangle
+        const bool thick = min_dist > 0.001f;
+        const int verts_per_edge = thick ? 12 : 3;
+        const int tris_per_edge = thick ? 4 : 1;
+
+        obj_mesh res;
+        res.positions.reserve(k * verts_per_edge);
+        res.normals.reserve(k * verts_per_edge);
+        res.uvs.reserve(k * verts_per_edge);
+        res.indexes.reserve(k * tris_per_edge);
+
         for (HalfEdge* e : c->halfEdges)
         {
             if (e->startPoint() && e->endPoint()) {
@@ -132,7 +151,7 @@ void generate_broken_glass(
 
                 int idx = res.positions.size();
 
-                if (min_dist > 0.001f)
+                if (thick)
                 {
                     res.positions.push_back(a - pos);
                     res.positions.push_back(b - pos);
@@ -210,6 +229,12 @@ void generate_broken_glass(
 
         if (res.positions.size() == 0) continue;
 
+        if (welded)
+        {
+            res = weld(res);
+            optimize_vertex_cache(res);
+        }
+
         res.calculate_tangents();
 
         float3 rotation{
@@ -219,12 +244,33 @@ void generate_broken_glass(
         };
         rotation = normalize(rotation);
 
-        peices.push_back({ res, min_dist, rotation, pos });
-
-        res = obj_mesh();
+        peices.push_back({ std::move(res), min_dist, rotation, pos });
     }
 }
 
+void generate_broken_glass(
+    std::vector<glass_peice>& peices)
+{
+    std::default_random_engine generator(std::random_device{}());
+    generate_broken_glass(peices, generator, false);
+}
+
+std::vector<std::vector<glass_peice>> generate_broken_glass(
+    worker_pool& pool, int variations, unsigned int seed, bool welded)
+{
+    std::vector<std::vector<glass_peice>> res(variations);
+
+    // Each variation gets its own engine derived from (seed, index),
+    // so the output does not depend on how work is split between threads
+    run_parallel(pool, variations, [&](int i) {
+        std::seed_seq seq{ seed, (unsigned int)i };
+        std::default_random_engine generator(seq);
+        generate_broken_glass(res[i], generator, welded);
+    });
+
+    return res;
+}
+
 obj_mesh apply(const obj_mesh& input, const float3x3& trans, const float3& t, bool flip_normals)
 {
     obj_mesh res;
@@ -233,6 +279,7 @@ obj_mesh apply(const obj_mesh& input, const float3x3& trans, const float3& t, bo
     res.positions = input.positions;
     res.normals = input.normals;
     res.tangents = input.tangents;
+    res.tangent_signs = input.tangent_signs;
 
     if (flip_normals)
     {
@@ -247,6 +294,10 @@ obj_mesh apply(const obj_mesh& input, const float3x3& trans, const float3& t, bo
     for (auto& p : res.tangents)
         p = mul(trans, p);
 
+    // Mirroring reverses the handedness of the tangent frame
+    if (determinant(trans) < 0.f)
+        for (auto& s : res.tangent_signs) s = -s;
+
     return res;
 }
 
@@ -286,6 +337,16 @@ obj_mesh fuse(const obj_mesh& a, const obj_mesh& b)
     res.normals.insert(res.normals.end(), b.normals.begin(), b.normals.end());
     res.tangents.insert(res.tangents.end(), b.tangents.begin(), b.tangents.end());
 
+    if (!a.tangent_signs.empty() || !b.tangent_signs.empty())
+    {
+        auto signs = [](const obj_mesh& m) {
+            return m.tangent_signs.empty() ? std::vector<float>(m.positions.size(), 1.f) : m.tangent_signs;
+        };
+        res.tangent_signs = signs(a);
+        auto more = signs(b);
+        res.tangent_signs.insert(res.tangent_signs.end(), more.begin(), more.end());
+    }
+
     auto max_u = std::max_element(res.uvs.begin(), res.uvs.end(), 
         [](const float2& a, const float2& b) { return a.x < b.x; });
     auto max_v = std::max_element(res.uvs.begin(), res.uvs.end(), 
@@ -320,6 +381,7 @@ obj_mesh filter(const obj_mesh& a, std::function<bool(const float3&)> pred, std:
             res.normals.push_back(a.normals[i]);
             res.uvs.push_back(a.uvs[i]);
             res.tangents.push_back(a.tangents[i]);
+            if (!a.tangent_signs.empty()) res.tangent_signs.push_back(a.tangent_signs[i]);
             idx++;
         }
     }
@@ -503,6 +565,43 @@ obj_mesh make_grid(int a, int b, float x, float y)
     return res;
 }
 
+obj_mesh make_cube(float size)
+{
+    obj_mesh res;
+
+    float3 axes[] = {
+        { 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f },
+        { 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f },
+        { 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f },
+    };
+
+    auto h = size / 2.f;
+    for (auto& n : axes)
+    {
+        // Two axes spanning the face, with u x v pointing along the normal
+        float3 u;
+        if (n.z != 0.f) u = { n.z, 0.f, 0.f };
+        else if (n.y != 0.f) u = { 0.f, 0.f, n.y };
+        else u = { 0.f, 0.f, -n.x };
+        auto v = cross(n, u);
+
+        int first = res.positions.size();
+        float2 corners[] = { { 0.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.f }, { 0.f, 1.f } };
+        for (auto& c : corners)
+        {
+            res.positions.push_back((n + u * (c.x * 2.f - 1.f) + v * (c.y * 2.f - 1.f)) * h);
+            res.normals.push_back(n);
+            res.uvs.push_back(c);
+        }
+        res.indexes.emplace_back(first, first + 1, first + 2);
+        res.indexes.emplace_back(first, first + 2, first + 3);
+    }
+
+    res.calculate_tangents();
+
+    return res;
+}
+
 obj_mesh generate_tube2(float length,
     float radius,
     float bend,
@@ -694,7 +793,7 @@ obj_mesh generate_tube_new(float length, float radius, float q)
 
 obj_mesh generate_tube3(float length,
     float radius,
-    int a, int b)
+    int a, int b, float q)
 {
     auto x = generate_tube2(length, radius, -1.f, a / 4, b / 4);
 
@@ -718,7 +817,7 @@ obj_mesh generate_tube3(float length,
 
     x = fuse(x, y);
 
-    auto z = generate_tube_new(length * 4.f / 3.f, radius, 1.f);
+    auto z = generate_tube_new(length * 4.f / 3.f, radius, q);
 
     float3x3 id{
         { 1.f, 0.f, 0.f },
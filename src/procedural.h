@@ -2,6 +2,9 @@
 
 #include "util.h"
 #include "loader.h"
+#include "worker-pool.h"
+
+#include <random>
 
 struct glass_peice
 {
@@ -14,17 +17,30 @@ struct glass_peice
 void generate_broken_glass(
     std::vector<glass_peice>& peices);
 
+// When welded, shared vertices are merged into an indexed mesh 
+// and triangles are reordered for the post-transform vertex cache
+void generate_broken_glass(
+    std::vector<glass_peice>& peices,
+    std::default_random_engine& generator,
+    bool welded);
+
+// Generates a batch of independent shattered-glass variations on the pool.
+// Results are deterministic for a given seed
+std::vector<std::vector<glass_peice>> generate_broken_glass(
+    worker_pool& pool, int variations, unsigned int seed, bool welded = true);
+
 obj_mesh apply(const obj_mesh& input, const float3x3& trans, const float3& t = { 0.f, 0.f, 0.f }, bool flip_normals = false);
 obj_mesh fuse(const obj_mesh& a, const obj_mesh& b);
 obj_mesh filter(const obj_mesh& a, std::function<bool(const float3&)> pred, std::vector<int>& edge);
 int nearest(const obj_mesh& a, const std::vector<int>& subset, int i);
 
 obj_mesh make_grid(int a, int b, float x, float y);
+obj_mesh make_cube(float size);
 
 obj_mesh generate_tube(float length,
     float radius, float bend, int a, int b);
 obj_mesh generate_tube3(float length,
-    float radius, int a, int b);
+    float radius, int a, int b, float q = 1.f);
 obj_mesh generate_tube4(float length,
     float radius, float bend, int a, int b);
 
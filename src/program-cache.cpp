@@ -0,0 +1,181 @@
+#include "program-cache.h"
+#include "util.h"
+
+#include <GL/gl3w.h>
+
+#include <easylogging++.h>
+
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    const char cache_magic[4] = { 'V', 'P', 'S', 'C' };
+    const uint32_t cache_version = 1;
+
+    struct cache_header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t size;
+    };
+
+    static_assert(sizeof(cache_header) == 24, "Unexpected program cache header size");
+
+    struct program_binary
+    {
+        uint32_t format = 0;
+        std::vector<char> data;
+    };
+
+    // Programs are recreated on every window reset, those reuse the binary from here
+    std::unordered_map<uint64_t, program_binary>& binaries()
+    {
+        static std::unordered_map<uint64_t, program_binary> res;
+        return res;
+    }
+
+    bool binaries_supported()
+    {
+        if (!glGetProgramBinary || !glProgramBinary) return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    void hash(uint64_t& h, const void* data, size_t size)
+    {
+        // FNV-1a
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+    }
+
+    void hash(uint64_t& h, const std::string& str)
+    {
+        hash(h, str.data(), str.size() + 1); // Terminator included, so "ab" + "c" != "a" + "bc"
+    }
+
+    void hash_gl_string(uint64_t& h, GLenum name)
+    {
+        auto str = (const char*)glGetString(name);
+        hash(h, str ? std::string(str) : std::string());
+    }
+}
+
+uint64_t program_cache_key(const std::string& vertex_source, const std::string& fragment_source)
+{
+    uint64_t h = 14695981039346656037ull;
+    hash(h, vertex_source);
+    hash(h, fragment_source);
+    hash_gl_string(h, GL_VENDOR);
+    hash_gl_string(h, GL_RENDERER);
+    hash_gl_string(h, GL_VERSION);
+    return h;
+}
+
+std::string program_cache_path(const std::string& directory, uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.cache", (unsigned long long)key);
+    return directory.empty() ? std::string(name) : directory + "/" + name;
+}
+
+bool load_program_binary(uint32_t program, const std::string& directory, uint64_t key)
+{
+    if (!binaries_supported()) return false;
+
+    auto& cache = binaries();
+    auto it = cache.find(key);
+    if (it == cache.end())
+    {
+        auto path = program_cache_path(directory, key);
+        if (!file_exists(path)) return false;
+
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        cache_header header;
+        in.read((char*)&header, sizeof(header));
+        if (!in.good() ||
+            memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+            header.version != cache_version ||
+            header.key != key)
+        {
+            return false;
+        }
+
+        program_binary binary;
+        binary.format = header.format;
+        binary.data.resize(header.size);
+        in.read(binary.data.data(), header.size);
+        if (!in.good()) return false;
+
+        it = cache.emplace(key, std::move(binary)).first;
+    }
+
+    auto& binary = it->second;
+    glProgramBinary(program, binary.format, binary.data.data(), (GLsizei)binary.data.size());
+
+    // Drivers reject binaries they can no longer use, the caller then compiles from source
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        LOG(WARNING) << "Cached program binary " << program_cache_path(directory, key) << " was rejected";
+        cache.erase(it);
+        return false;
+    }
+    return true;
+}
+
+bool save_program_binary(uint32_t program, const std::string& directory, uint64_t key)
+{
+    if (!binaries_supported()) return false;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+
+    program_binary binary;
+    binary.data.resize(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data.data());
+    binary.data.resize(length);
+    binary.format = format;
+
+    cache_header header;
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.key = key;
+    header.format = format;
+    header.size = (uint32_t)length;
+
+    // Written to a temporary file first, so a crash never leaves a half written cache
+    auto path = program_cache_path(directory, key);
+    auto temp = path + ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (out.is_open())
+        {
+            out.write((const char*)&header, sizeof(header));
+            out.write(binary.data.data(), binary.data.size());
+            written = out.good();
+        }
+    }
+    if (written)
+    {
+        remove(path.c_str());
+        written = rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    binaries()[key] = std::move(binary);
+    return written;
+}
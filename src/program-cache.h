@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+// Linked program binaries (glGetProgramBinary), kept in memory for the life of the
+// process and on disk as "<directory>/<key>.cache". Keys combine the shader sources 
+// with the GL vendor, renderer and version, so a driver update never loads a stale binary.
+// Everything here is a no-op returning false when the driver offers no binary formats
+uint64_t program_cache_key(const std::string& vertex_source, const std::string& fragment_source);
+
+std::string program_cache_path(const std::string& directory, uint64_t key);
+
+// Returns true when a cached binary was found and the driver accepted it
+bool load_program_binary(uint32_t program, const std::string& directory, uint64_t key);
+
+// Program must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+bool save_program_binary(uint32_t program, const std::string& directory, uint64_t key);
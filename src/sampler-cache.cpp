@@ -0,0 +1,47 @@
+#include "sampler-cache.h"
+
+#include <GL/gl3w.h>
+
+sampler_cache::~sampler_cache()
+{
+    release();
+}
+
+uint32_t sampler_cache::get(bool linear, bool mipmap)
+{
+    auto& sampler = _samplers[(linear ? 1 : 0) + (mipmap ? 2 : 0)];
+    if (!sampler)
+    {
+        glGenSamplers(1, &sampler);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, linear ? GL_LINEAR : GL_NEAREST);
+        if (mipmap)
+        {
+            glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glSamplerParameterf(sampler, GL_TEXTURE_LOD_BIAS, -1);
+        }
+        else
+        {
+            glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, linear ? GL_LINEAR : GL_NEAREST);
+        }
+    }
+    return sampler;
+}
+
+void sampler_cache::bind(int slot, bool linear, bool mipmap)
+{
+    glBindSampler(slot, get(linear, mipmap));
+}
+
+void sampler_cache::unbind(int slot)
+{
+    glBindSampler(slot, 0);
+}
+
+void sampler_cache::release()
+{
+    for (auto& sampler : _samplers)
+    {
+        if (sampler) glDeleteSamplers(1, &sampler);
+        sampler = 0;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// One GL sampler object per filtering mode, created on first use.
+// Filtering is bound per texture slot, so changing it never touches texture storage
+class sampler_cache
+{
+public:
+    sampler_cache() {}
+    ~sampler_cache();
+
+    uint32_t get(bool linear, bool mipmap);
+
+    void bind(int slot, bool linear, bool mipmap);
+    static void unbind(int slot);
+
+    // Deletes the sampler objects, call before the context goes away
+    void release();
+
+private:
+    sampler_cache(const sampler_cache& other) = delete;
+
+    uint32_t _samplers[4] = {};
+};
@@ -0,0 +1,87 @@
+#include "shader-preprocessor.h"
+#include "util.h"
+
+#include <sstream>
+#include <algorithm>
+#include <set>
+
+namespace
+{
+    // Returns true and the file name when line is an #include directive
+    bool parse_include(const std::string& line, std::string& name)
+    {
+        auto pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line.compare(pos, 8, "#include") != 0) return false;
+
+        auto begin = line.find('"', pos + 8);
+        auto end = begin == std::string::npos ? begin : line.find('"', begin + 1);
+        if (end == std::string::npos)
+            throw std::runtime_error(str() << "Malformed include '" << line << "'");
+
+        name = line.substr(begin + 1, end - begin - 1);
+        return true;
+    }
+
+    bool is_version(const std::string& line)
+    {
+        auto pos = line.find_first_not_of(" \t");
+        return pos != std::string::npos && line.compare(pos, 8, "#version") == 0;
+    }
+
+    void expand(const std::string& filename, int depth,
+                const std::vector<std::string>& defines,
+                std::set<std::string>& included, std::ostringstream& out)
+    {
+        if (!included.insert(filename).second) return;
+
+        std::istringstream in(read_all_text(filename));
+        auto directory = get_directory(filename);
+
+        std::string line;
+        int line_number = 0;
+        while (std::getline(in, line))
+        {
+            line_number++;
+
+            std::string name;
+            if (parse_include(line, name))
+            {
+                auto path = directory.empty() ? name : directory + "/" + name;
+                out << "#line 1 " << depth + 1 << "\n";
+                expand(path, depth + 1, defines, included, out);
+                out << "#line " << line_number + 1 << " " << depth << "\n";
+            }
+            else if (depth == 0 && is_version(line))
+            {
+                out << line << "\n";
+                for (auto& d : defines) out << "#define " << d << " 1\n";
+                out << "#line " << line_number + 1 << " " << depth << "\n";
+            }
+            else
+            {
+                out << line << "\n";
+            }
+        }
+    }
+}
+
+std::string preprocess_shader(const std::string& filename,
+                              const std::vector<std::string>& defines)
+{
+    std::ostringstream out;
+    std::set<std::string> included;
+    expand(filename, 0, defines, included, out);
+    return out.str();
+}
+
+std::string permutation_key(std::vector<std::string> defines)
+{
+    std::sort(defines.begin(), defines.end());
+    std::string res;
+    for (auto& d : defines)
+    {
+        if (!res.empty()) res += ";";
+        res += d;
+    }
+    return res;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Expands #include "file" directives (paths relative to the including file,
+// every file included at most once) and injects a #define for each entry in
+// defines right after #version. #line directives keep compiler messages
+// pointing at the original lines, the source string number is the include depth
+std::string preprocess_shader(const std::string& filename,
+                              const std::vector<std::string>& defines = {});
+
+// Identifies one specialization of a shader: the defines in a fixed order
+std::string permutation_key(std::vector<std::string> defines);
@@ -1,23 +1,49 @@
 #include "shader.h"
+#include "program-cache.h"
+#include "shader-preprocessor.h"
 #include "util.h"
 
 #include <GL/gl3w.h>
 
 #include <easylogging++.h>
 
+#include <string.h>
+
+uniform_statistics shader_program::_statistics;
+
 int shader_program::get_uniform_location(const std::string& name)
 {
     return glGetUniformLocation(_id, name.c_str());
 }
 
+bool shader_program::update_shadow(int location, const void* data, int size)
+{
+    // GL ignores location -1 (optimized out uniforms), no need to track it
+    if (location < 0) return false;
+
+    auto& value = _uniforms[location];
+    if (value.size == size && memcmp(value.data, data, size) == 0)
+    {
+        _statistics.skipped++;
+        return false;
+    }
+
+    value.size = size;
+    memcpy(value.data, data, size);
+    _statistics.issued++;
+    return true;
+}
+
 void shader_program::load_uniform(int location, int value)
 {
-    glUniform1i(location, value);
+    if (update_shadow(location, &value, sizeof(value)))
+        glUniform1i(location, value);
 }
 
 void shader_program::load_uniform(int location, float value)
 {
-    glUniform1f(location, value);
+    if (update_shadow(location, &value, sizeof(value)))
+        glUniform1f(location, value);
 }
 
 void shader_program::load_uniform(int location, bool value)
@@ -27,25 +53,34 @@ void shader_program::load_uniform(int location, bool value)
 
 void shader_program::load_uniform(int location, const float2& vec)
 {
-    glUniform2f(location, vec.x, vec.y);
+    if (update_shadow(location, &vec, sizeof(vec)))
+        glUniform2f(location, vec.x, vec.y);
 }
 
 void shader_program::load_uniform(int location, const float3& vec)
 {
-    glUniform3f(location, vec.x, vec.y, vec.z);
+    if (update_shadow(location, &vec, sizeof(vec)))
+        glUniform3f(location, vec.x, vec.y, vec.z);
 }
 
 void shader_program::load_uniform(int location, const float4x4& matrix)
 {
-    glUniformMatrix4fv(location, 1, GL_FALSE, (float*)&matrix);
+    if (update_shadow(location, &matrix, sizeof(matrix)))
+        glUniformMatrix4fv(location, 1, GL_FALSE, (float*)&matrix);
 }
 
-void shader_program::bind_attribute(int attr, const std::string& name)
+void shader_program::bind_uniform_block(const std::string& name, int binding)
 {
-    glBindAttribLocation(_id, attr, name.c_str());
+    auto index = glGetUniformBlockIndex(_id, name.c_str());
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(_id, index, binding);
 }
 
 shader::shader(const std::string& filename, shader_type type)
+    : shader(filename, preprocess_shader(filename), type)
+{
+}
+
+shader::shader(const std::string& filename, const std::string& shader_code, shader_type type)
 {
     auto lambda = [&](){
         switch(type)
@@ -60,7 +95,6 @@ shader::shader(const std::string& filename, shader_type type)
     
     GLuint shader_id = glCreateShader(gl_type);
 
-    auto shader_code = read_all_text(filename);
     LOG(INFO) << "Compiling shader " << filename << "...";
     
     char const * source_ptr = shader_code.c_str();
@@ -153,6 +187,9 @@ void shader_program::link()
     }
     
     LOG(INFO) << "Shader Program ready";
+
+    // Linking resets every uniform to its default
+    _uniforms.clear();
     
     for(auto ps : _shaders)
     {
@@ -172,13 +209,67 @@ void shader_program::end() const
 
 std::unique_ptr<shader_program> shader_program::load(
                                 const std::string& vertex_shader,
-                                const std::string& fragment_shader)
+                                const std::string& fragment_shader,
+                                const std::vector<std::string>& defines)
 {
     std::unique_ptr<shader_program> res(new shader_program());
-    shader vertex(vertex_shader, shader_type::vertex);
-    shader fragment(fragment_shader, shader_type::fragment);
+
+    auto vertex_code = preprocess_shader(vertex_shader, defines);
+    auto fragment_code = preprocess_shader(fragment_shader, defines);
+    auto key = program_cache_key(vertex_code, fragment_code);
+    auto directory = get_directory(vertex_shader);
+
+    if (load_program_binary(res->_id, directory, key))
+    {
+        LOG(INFO) << "Loaded cached program for " << vertex_shader << " and " << fragment_shader;
+        return res;
+    }
+
+    shader vertex(vertex_shader, vertex_code, shader_type::vertex);
+    shader fragment(fragment_shader, fragment_code, shader_type::fragment);
     res->attach(vertex);
     res->attach(fragment);
+    if (glProgramParameteri)
+        glProgramParameteri(res->_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     res->link();
-    return std::move(res);
+
+    save_program_binary(res->_id, directory, key);
+    return res;
+}
+
+shader_registry* shader_registry::_current = nullptr;
+
+shader_registry::~shader_registry()
+{
+    if (_current == this) _current = nullptr;
+}
+
+shader_registry& shader_registry::current()
+{
+    if (!_current) throw std::runtime_error("No GL context is current!");
+    return *_current;
+}
+
+std::shared_ptr<shader_program> shader_registry::get(
+    const std::string& vertex_shader,
+    const std::string& fragment_shader,
+    const std::vector<std::string>& defines)
+{
+    auto key = std::make_tuple(vertex_shader, fragment_shader, permutation_key(defines));
+    auto it = _programs.find(key);
+    if (it != _programs.end())
+    {
+        _hits++;
+        return it->second;
+    }
+
+    std::shared_ptr<shader_program> res = shader_program::load(vertex_shader, fragment_shader, defines);
+    _programs.emplace(key, res);
+    return res;
+}
+
+void shader_registry::release()
+{
+    _programs.clear();
+    _hits = 0;
 }
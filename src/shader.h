@@ -5,6 +5,8 @@
 
 #include <string>
 #include <unordered_map>
+#include <map>
+#include <tuple>
 #include <vector>
 #include <memory>
 
@@ -18,6 +20,8 @@ class shader
 {
 public:
     shader(const std::string& filename, shader_type type);
+    // Compiles source directly, name is only used in the log
+    shader(const std::string& name, const std::string& source, shader_type type);
     ~shader();
     
     unsigned int get_id() const { return _id; }
@@ -26,6 +30,13 @@ private:
     unsigned int _id;
 };
 
+// Uniform updates since the last reset, over all programs
+struct uniform_statistics
+{
+    int issued = 0;
+    int skipped = 0;
+};
+
 class shader_program
 {
 public:
@@ -38,9 +49,12 @@ public:
     void begin() const;
     void end() const;
     
+    // Sources go through preprocess_shader, defines select the permutation.
+    // Reuses the linked binary from the program cache when the sources are unchanged
     static std::unique_ptr<shader_program> load(
                             const std::string& vertex_shader,
-                            const std::string& fragment_shader);
+                            const std::string& fragment_shader,
+                            const std::vector<std::string>& defines = {});
                               
     unsigned int get_id() const { return _id; }
 
@@ -52,9 +66,61 @@ public:
     void load_uniform(int location, int value);
     void load_uniform(int location, const float4x4& matrix);
 
-    void bind_attribute(int attr, const std::string& name);
+    // Does nothing when the program does not use the block
+    void bind_uniform_block(const std::string& name, int binding);
+
+    static uniform_statistics statistics() { return _statistics; }
+    static void reset_statistics() { _statistics = uniform_statistics(); }
 
 private:
+    // Last value sent to each location. Uniforms are program state, so a value
+    // equal to the shadow copy is already in place and the GL call can be skipped
+    struct uniform_value
+    {
+        int size = 0;
+        float data[16];
+    };
+
+    bool update_shadow(int location, const void* data, int size);
+
     std::vector<const shader*> _shaders;
     unsigned int _id;
+    std::unordered_map<int, uniform_value> _uniforms;
+
+    static uniform_statistics _statistics;
+};
+
+// Programs of one GL context, one per distinct vertex / fragment pair
+// and permutation. Shader objects hold shared handles, so a program is compiled
+// (or loaded from the program cache) once however many objects use it.
+// Every window owns the registry of its context
+class shader_registry
+{
+public:
+    shader_registry() {}
+    ~shader_registry();
+
+    // Registry of the window whose context was made current last
+    static shader_registry& current();
+    void make_current() { _current = this; }
+
+    std::shared_ptr<shader_program> get(const std::string& vertex_shader,
+                                        const std::string& fragment_shader,
+                                        const std::vector<std::string>& defines = {});
+
+    // Drops the registry's references. Called when the window goes away,
+    // programs still held elsewhere are deleted with their last handle
+    void release();
+
+    int size() const { return (int)_programs.size(); }
+    int hits() const { return _hits; }
+
+private:
+    shader_registry(const shader_registry& other) = delete;
+
+    typedef std::tuple<std::string, std::string, std::string> program_key;
+    std::map<program_key, std::shared_ptr<shader_program>> _programs;
+    int _hits = 0;
+
+    static shader_registry* _current;
 };
\ No newline at end of file
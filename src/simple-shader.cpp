@@ -1,6 +1,6 @@
 #include "simple-shader.h"
 
-simple_shader::simple_shader(std::unique_ptr<shader_program> shader)
+simple_shader::simple_shader(std::shared_ptr<shader_program> shader)
     : _shader(std::move(shader))
 {
     init();
@@ -8,7 +8,7 @@ simple_shader::simple_shader(std::unique_ptr<shader_program> shader)
 
 simple_shader::simple_shader()
 {
-    _shader = shader_program::load(
+    _shader = shader_registry::current().get(
         "resources/shaders/simple/simp-vertex.glsl",
         "resources/shaders/simple/simp-fragment.glsl");
 
@@ -17,29 +17,31 @@ simple_shader::simple_shader()
 
 void simple_shader::init()
 {
-    _shader->bind_attribute(0, "position");
-    _shader->bind_attribute(1, "textureCoords");
-    _shader->bind_attribute(2, "normal");
-    _shader->bind_attribute(3, "tangent");
+    prepare(*_shader);
 
     _transformation_matrix_location = _shader->get_uniform_location("transformationMatrix");
-    _projection_matrix_location = _shader->get_uniform_location("projectionMatrix");
-    _camera_matrix_location = _shader->get_uniform_location("cameraMatrix");
 
-    _light_position_location = _shader->get_uniform_location("lightPosition");
+    _material.set(material_data());
+}
+
+void simple_shader::prepare(shader_program& program)
+{
+    program.bind_uniform_block("FrameData", (int)uniform_binding::frame);
+    program.bind_uniform_block("Material", (int)uniform_binding::material);
 
-    _ambient_location = _shader->get_uniform_location("ambient");
-    _shine_location = _shader->get_uniform_location("shineDamper");
-    _reflectivity_location = _shader->get_uniform_location("reflectivity");
+    auto texture0_sampler_location = program.get_uniform_location("textureSampler");
 
-    auto texture0_sampler_location = _shader->get_uniform_location("textureSampler");
+    program.begin();
+    program.load_uniform(texture0_sampler_location, diffuse_slot());
+    program.end();
+}
 
+void simple_shader::begin()
+{
     _shader->begin();
-    _shader->load_uniform(texture0_sampler_location, diffuse_slot());
-    _shader->end();
+    _material.bind(uniform_binding::material);
 }
 
-void simple_shader::begin() { _shader->begin(); }
 void simple_shader::end() { _shader->end(); }
 
 void simple_shader::set_model(const float4x4& model)
@@ -47,35 +49,20 @@ void simple_shader::set_model(const float4x4& model)
     _shader->load_uniform(_transformation_matrix_location, model);
 }
 
-void simple_shader::set_mvp(const float4x4& model,
-    const float4x4& view,
-    const float4x4& projection)
-{
-    _shader->load_uniform(_transformation_matrix_location, model);
-    _shader->load_uniform(_camera_matrix_location, view);
-    _shader->load_uniform(_projection_matrix_location, projection);
-}
-
-void simple_shader::set_light(const float3& l)
-{
-    _shader->load_uniform(_light_position_location, l);
-}
-
 void simple_shader::set_material_properties(
     float ambient, float shine, float reflectivity)
 {
-    _shader->load_uniform(_shine_location, shine);
-    _shader->load_uniform(_reflectivity_location, reflectivity);
-    _shader->load_uniform(_ambient_location, ambient);
-
-    _ambient = ambient;
-    _shine = shine;
-    _reflectivity = reflectivity;
+    auto material = _material.get();
+    material.ambient = ambient;
+    material.shine = shine;
+    material.reflectivity = reflectivity;
+    _material.set(material);
 }
 
 void simple_shader::get_material_properties(float & ambient, float & shine, float & reflectivity)
 {
-    ambient = _ambient;
-    shine = _shine;
-    reflectivity = _reflectivity;
+    auto& material = _material.get();
+    ambient = material.ambient;
+    shine = material.shine;
+    reflectivity = material.reflectivity;
 }
@@ -2,7 +2,10 @@
 
 #include "util.h"
 #include "shader.h"
+#include "uniform-buffer.h"
 
+// View, projection and light come from the FrameData block (uniform_binding::frame),
+// only the model matrix and the material are per shader
 class simple_shader
 {
 public:
@@ -11,15 +14,9 @@ public:
     void begin();
     void end();
 
-    void set_mvp(const float4x4& model,
-                 const float4x4& view,
-                 const float4x4& projection);
-
     void set_model(const float4x4& model);
 
-    void set_light(const float3& l);
-
-    virtual void set_material_properties(float ambient,
+    void set_material_properties(float ambient,
         float shine, float reflectivity);
 
     void get_material_properties(float& ambient, float& shine, float& reflectivity);
@@ -27,22 +24,15 @@ public:
     int diffuse_slot() const { return 0; }
 
 protected:
-    simple_shader(std::unique_ptr<shader_program> shader);
-
-    std::unique_ptr<shader_program> _shader;
+    simple_shader(std::shared_ptr<shader_program> shader);
 
-private:
-    void init();
+    // Binds attributes, uniform blocks and the diffuse sampler of a program
+    void prepare(shader_program& program);
 
+    std::shared_ptr<shader_program> _shader;
+    uniform_block<material_data> _material;
     uint32_t _transformation_matrix_location;
-    uint32_t _projection_matrix_location;
-    uint32_t _camera_matrix_location;
 
-    uint32_t _light_position_location;
-
-    uint32_t _ambient_location;
-    uint32_t _shine_location;
-    uint32_t _reflectivity_location;
-
-    float _ambient, _shine, _reflectivity;
-};
\ No newline at end of file
+private:
+    void init();
+};
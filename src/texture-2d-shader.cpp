@@ -1,6 +1,6 @@
 #include "texture-2d-shader.h"
 
-texture_2d_shader::texture_2d_shader(std::unique_ptr<shader_program> shader)
+texture_2d_shader::texture_2d_shader(std::shared_ptr<shader_program> shader)
     : _shader(std::move(shader))
 {
     init();
@@ -8,7 +8,7 @@ texture_2d_shader::texture_2d_shader(std::unique_ptr<shader_program> shader)
 
 texture_2d_shader::texture_2d_shader()
 {
-    _shader = shader_program::load(
+    _shader = shader_registry::current().get(
         "resources/shaders/planar/plane-vertex.glsl",
         "resources/shaders/planar/plane-fragment.glsl");
 
@@ -25,9 +25,6 @@ void texture_2d_shader::set_position_and_scale(
 
 void texture_2d_shader::init()
 {
-    _shader->bind_attribute(0, "position");
-    _shader->bind_attribute(1, "textureCoords");
-
     _position_location = _shader->get_uniform_location("elementPosition");
     _scale_location = _shader->get_uniform_location("elementScale");
 
@@ -18,9 +18,9 @@ public:
         const float2& scale);
 
 protected:
-    texture_2d_shader(std::unique_ptr<shader_program> shader);
+    texture_2d_shader(std::shared_ptr<shader_program> shader);
 
-    std::unique_ptr<shader_program> _shader;
+    std::shared_ptr<shader_program> _shader;
 
 private:
     void init();
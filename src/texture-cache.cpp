@@ -0,0 +1,135 @@
+#include "texture-cache.h"
+#include "mapped-file.h"
+#include "util.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    const char cache_magic[4] = { 'V', 'P', 'T', 'C' };
+    const uint32_t cache_version = 2;
+
+    struct cache_header
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint32_t format;
+        uint32_t usage;
+        uint32_t level_count;
+        uint32_t compressed; // As requested, the format may still be uncompressed
+        uint64_t data_offset; // Level offsets are relative to this
+        uint64_t data_size;
+    };
+
+    struct cache_level
+    {
+        uint32_t width, height;
+        uint64_t offset;
+    };
+
+    static_assert(sizeof(cache_header) == 56, "Unexpected texture cache header size");
+    static_assert(sizeof(cache_level) == 16, "Unexpected texture cache level size");
+}
+
+std::string texture_cache_path(const std::string& source)
+{
+    return source + ".cache";
+}
+
+bool read_texture_cache(const std::string& source, texture_usage usage, bool compressed,
+    texture_image& image)
+{
+    auto path = texture_cache_path(source);
+    uint64_t size;
+    int64_t mtime;
+    if (!file_exists(path) || !file_stamp(source, size, mtime)) return false;
+
+    mapped_file file(path);
+    auto data = file.data();
+
+    cache_header header;
+    if (file.size() < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.version != cache_version ||
+        header.source_size != size ||
+        header.source_mtime != mtime ||
+        header.usage != (uint32_t)usage ||
+        header.compressed != (compressed ? 1u : 0u) ||
+        header.format > (uint32_t)pixel_format::bc5 ||
+        header.level_count == 0)
+    {
+        return false;
+    }
+
+    auto levels_end = sizeof(header) + (uint64_t)header.level_count * sizeof(cache_level);
+    if (levels_end > header.data_offset ||
+        header.data_offset + header.data_size > file.size())
+    {
+        return false;
+    }
+
+    texture_image res;
+    res.format = (pixel_format)header.format;
+    for (uint32_t i = 0; i < header.level_count; i++)
+    {
+        cache_level l;
+        memcpy(&l, data + sizeof(header) + i * sizeof(cache_level), sizeof(l));
+
+        // A truncated file is treated as a stale cache
+        if (l.offset + level_size(res.format, l.width, l.height) > header.data_size) return false;
+
+        mip_level level;
+        level.width = l.width;
+        level.height = l.height;
+        level.offset = l.offset;
+        res.levels.push_back(level);
+    }
+
+    auto first = data + header.data_offset;
+    res.data.assign(first, first + header.data_size);
+
+    image = std::move(res);
+    return true;
+}
+
+bool write_texture_cache(const std::string& source, texture_usage usage, bool compressed,
+    const texture_image& image)
+{
+    cache_header header;
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = cache_version;
+    header.format = (uint32_t)image.format;
+    header.usage = (uint32_t)usage;
+    header.level_count = (uint32_t)image.levels.size();
+    header.compressed = compressed ? 1 : 0;
+    header.data_offset = sizeof(header) + image.levels.size() * sizeof(cache_level);
+    header.data_size = image.data.size();
+    if (!file_stamp(source, header.source_size, header.source_mtime)) return false;
+
+    std::vector<cache_level> levels;
+    for (auto& l : image.levels)
+        levels.push_back({ (uint32_t)l.width, (uint32_t)l.height, (uint64_t)l.offset });
+
+    // Written to a temporary file first, so a crash never leaves a half written cache
+    auto path = texture_cache_path(source);
+    auto temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)levels.data(), levels.size() * sizeof(cache_level));
+        out.write((const char*)image.data.data(), image.data.size());
+
+        if (!out.good()) return false;
+    }
+
+    remove(path.c_str());
+    return rename(temp.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "texture.h"
+
+#include <string>
+
+// Processed texture stored next to its source ("<source>.cache"): the pixel format,
+// every mip level and their pixels, ready to be handed to OpenGL as is.
+// The cache is only used while the source file size and modification time 
+// match the ones it was written from, and it was written for the same usage 
+// and with compression requested or not
+std::string texture_cache_path(const std::string& source);
+
+bool read_texture_cache(const std::string& source, texture_usage usage, bool compressed,
+    texture_image& image);
+
+// Returns false if the cache could not be written, loading still works without it
+bool write_texture_cache(const std::string& source, texture_usage usage, bool compressed,
+    const texture_image& image);
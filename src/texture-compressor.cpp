@@ -0,0 +1,254 @@
+#include "texture-compressor.h"
+#include "worker-pool.h"
+#include "util.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <math.h>
+
+namespace
+{
+    // Block pixels expanded to RGBA, in row order
+    typedef uint8_t block_pixels[16][4];
+
+    void fetch_block(const uint8_t* pixels, int width, int height, int channels,
+        int bx, int by, block_pixels& out)
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            auto sy = std::min(by * 4 + y, height - 1);
+            for (int x = 0; x < 4; x++)
+            {
+                auto sx = std::min(bx * 4 + x, width - 1);
+                auto p = pixels + ((size_t)sy * width + sx) * channels;
+                auto& o = out[y * 4 + x];
+                o[0] = p[0];
+                o[1] = channels > 1 ? p[1] : p[0];
+                o[2] = channels > 2 ? p[2] : (channels > 1 ? 0 : p[0]);
+                o[3] = channels > 3 ? p[3] : 255;
+            }
+        }
+    }
+
+    uint16_t pack_565(const float3& c)
+    {
+        auto q = [](float v, int max) {
+            return (int)std::max(0.f, std::min((float)max, roundf(v * max / 255.f)));
+        };
+        return (uint16_t)((q(c.x, 31) << 11) | (q(c.y, 63) << 5) | q(c.z, 31));
+    }
+
+    float3 unpack_565(uint16_t v)
+    {
+        int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+        return { (float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)) };
+    }
+
+    void write_u16(uint8_t* dst, uint16_t v)
+    {
+        dst[0] = v & 0xff;
+        dst[1] = v >> 8;
+    }
+
+    // BC1 colour block: endpoints on the principal axis of the block colours,
+    // inset a little so the interpolated colours cover the range evenly
+    void encode_color(const block_pixels& px, uint8_t* dst)
+    {
+        float3 mean{ 0.f, 0.f, 0.f };
+        for (auto& p : px) mean += float3{ (float)p[0], (float)p[1], (float)p[2] };
+        mean = mean / 16.f;
+
+        float cov[6] = {};
+        for (auto& p : px)
+        {
+            float3 d = float3{ (float)p[0], (float)p[1], (float)p[2] } - mean;
+            cov[0] += d.x * d.x; cov[1] += d.x * d.y; cov[2] += d.x * d.z;
+            cov[3] += d.y * d.y; cov[4] += d.y * d.z; cov[5] += d.z * d.z;
+        }
+
+        float3 axis{ 1.f, 1.f, 1.f };
+        for (int i = 0; i < 4; i++)
+        {
+            axis = { cov[0] * axis.x + cov[1] * axis.y + cov[2] * axis.z,
+                     cov[1] * axis.x + cov[3] * axis.y + cov[4] * axis.z,
+                     cov[2] * axis.x + cov[4] * axis.y + cov[5] * axis.z };
+            auto l = length(axis);
+            if (l < 1e-6f)
+            {
+                axis = { 0.f, 0.f, 0.f };
+                break;
+            }
+            axis = axis / l;
+        }
+
+        float lo = 0.f, hi = 0.f;
+        for (auto& p : px)
+        {
+            auto t = dot(float3{ (float)p[0], (float)p[1], (float)p[2] } - mean, axis);
+            lo = std::min(lo, t);
+            hi = std::max(hi, t);
+        }
+        auto inset = (hi - lo) / 16.f;
+        auto c0 = pack_565(mean + axis * (hi - inset));
+        auto c1 = pack_565(mean + axis * (lo + inset));
+
+        // c0 > c1 selects the four colour mode
+        if (c0 < c1) std::swap(c0, c1);
+        write_u16(dst, c0);
+        write_u16(dst + 2, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1)
+        {
+            float3 palette[4];
+            palette[0] = unpack_565(c0);
+            palette[1] = unpack_565(c1);
+            palette[2] = (palette[0] * 2.f + palette[1]) / 3.f;
+            palette[3] = (palette[0] + palette[1] * 2.f) / 3.f;
+
+            for (int i = 0; i < 16; i++)
+            {
+                float3 c{ (float)px[i][0], (float)px[i][1], (float)px[i][2] };
+                int best = 0;
+                float best_dist = length2(c - palette[0]);
+                for (int k = 1; k < 4; k++)
+                {
+                    auto d = length2(c - palette[k]);
+                    if (d < best_dist)
+                    {
+                        best_dist = d;
+                        best = k;
+                    }
+                }
+                indices |= (uint32_t)best << (2 * i);
+            }
+        }
+        for (int i = 0; i < 4; i++) dst[4 + i] = (indices >> (8 * i)) & 0xff;
+    }
+
+    // BC4 single channel block (BC3 alpha, BC5 red and green), eight value mode
+    void encode_channel(const block_pixels& px, int channel, uint8_t* dst)
+    {
+        int lo = 255, hi = 0;
+        for (auto& p : px)
+        {
+            lo = std::min(lo, (int)p[channel]);
+            hi = std::max(hi, (int)p[channel]);
+        }
+        dst[0] = (uint8_t)hi;
+        dst[1] = (uint8_t)lo;
+
+        uint64_t indices = 0;
+        if (hi != lo)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                // Steps from the first endpoint, palette indices are 0, 2..7, 1
+                int step = ((hi - px[i][channel]) * 7 + (hi - lo) / 2) / (hi - lo);
+                int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+                indices |= (uint64_t)index << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++) dst[2 + i] = (indices >> (8 * i)) & 0xff;
+    }
+}
+
+bool choose_block_format(const uint8_t* pixels, int width, int height, int channels,
+    texture_usage usage, pixel_format& format)
+{
+    if (usage == texture_usage::normal_map)
+    {
+        if (channels < 2) return false;
+        format = pixel_format::bc5;
+        return true;
+    }
+
+    if (channels == 3)
+    {
+        format = pixel_format::bc1;
+        return true;
+    }
+    if (channels == 4)
+    {
+        // BC1 halves the size again when the alpha channel carries nothing
+        auto count = (size_t)width * height;
+        bool opaque = true;
+        for (size_t i = 0; i < count && opaque; i++)
+            opaque = pixels[i * 4 + 3] == 255;
+        format = opaque ? pixel_format::bc1 : pixel_format::bc3;
+        return true;
+    }
+    return false;
+}
+
+void compress_level(worker_pool& pool, pixel_format format, const uint8_t* pixels,
+    int width, int height, int channels, uint8_t* dst)
+{
+    if (!is_compressed(format))
+        throw std::runtime_error("Not a block compressed format!");
+
+    const int blocks_x = (width + 3) / 4;
+    const int blocks_y = (height + 3) / 4;
+    const size_t block_size = format == pixel_format::bc1 ? 8 : 16;
+
+    // Rows of blocks are independent, large levels are split across the pool
+    const int rows_per_job = 16;
+    auto jobs = (blocks_y + rows_per_job - 1) / rows_per_job;
+
+    auto encode_rows = [&](int job) {
+        block_pixels px;
+        auto end = std::min(blocks_y, (job + 1) * rows_per_job);
+        for (int by = job * rows_per_job; by < end; by++)
+        {
+            auto out = dst + (size_t)by * blocks_x * block_size;
+            for (int bx = 0; bx < blocks_x; bx++, out += block_size)
+            {
+                fetch_block(pixels, width, height, channels, bx, by, px);
+                switch (format)
+                {
+                case pixel_format::bc1:
+                    encode_color(px, out);
+                    break;
+                case pixel_format::bc3:
+                    encode_channel(px, 3, out);
+                    encode_color(px, out + 8);
+                    break;
+                case pixel_format::bc5:
+                    encode_channel(px, 0, out);
+                    encode_channel(px, 1, out + 8);
+                    break;
+                default: break;
+                }
+            }
+        }
+    };
+
+    if (jobs > 1) run_parallel(pool, jobs, encode_rows);
+    else if (jobs == 1) encode_rows(0);
+}
+
+texture_image compress_image(worker_pool& pool, const texture_image& image, pixel_format format)
+{
+    texture_image res;
+    res.format = format;
+    res.decode_time = image.decode_time;
+
+    size_t total = 0;
+    for (auto l : image.levels)
+    {
+        l.offset = total;
+        total += level_size(format, l.width, l.height);
+        res.levels.push_back(l);
+    }
+    res.data.resize(total);
+
+    auto channels = channel_count(image.format);
+    for (size_t i = 0; i < image.levels.size(); i++)
+    {
+        auto& src = image.levels[i];
+        compress_level(pool, format, image.data.data() + src.offset, src.width, src.height,
+            channels, res.data.data() + res.levels[i].offset);
+    }
+    return res;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "texture.h"
+#include "worker-pool.h"
+
+// Picks a block format for an 8-bit image, returns false when it should stay uncompressed.
+// Normal maps go to BC5, opaque colour to BC1 and colour with alpha to BC3
+bool choose_block_format(const uint8_t* pixels, int width, int height, int channels,
+    texture_usage usage, pixel_format& format);
+
+// Encodes one level into 4x4 blocks. BC1 and BC3 read RGB(A), BC5 the first two channels.
+// Partial blocks at the edges repeat the last row and column.
+// dst must hold level_size(format, width, height) bytes, large levels are split across the pool
+void compress_level(worker_pool& pool, pixel_format format, const uint8_t* pixels, 
+    int width, int height, int channels, uint8_t* dst);
+
+// Compresses every level of an uncompressed image
+texture_image compress_image(worker_pool& pool, const texture_image& image, pixel_format format);
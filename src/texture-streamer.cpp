@@ -0,0 +1,164 @@
+#include "texture-streamer.h"
+#include "texture-cache.h"
+#include "texture-compressor.h"
+#include "mip-chain.h"
+
+#include <GL/gl3w.h>
+
+#include <easylogging++.h>
+
+#include <chrono>
+#include <string.h>
+
+namespace
+{
+    texture_image load_image(worker_pool& pool, const std::string& filename, 
+        texture_usage usage, bool compress)
+    {
+        using namespace std::chrono;
+
+        auto start = high_resolution_clock::now();
+        auto elapsed = [&]() {
+            auto duration = high_resolution_clock::now() - start;
+            return duration_cast<microseconds>(duration).count() / 1000.f;
+        };
+
+        texture_image res;
+        if (read_texture_cache(filename, usage, compress, res))
+        {
+            res.decode_time = elapsed();
+            return res;
+        }
+
+        auto decoded = decode_image(filename);
+        res = build_mip_chain(decoded.pixels.get(), 
+            decoded.width, decoded.height, decoded.channels, usage);
+
+        pixel_format format;
+        if (compress && choose_block_format(decoded.pixels.get(), 
+            decoded.width, decoded.height, decoded.channels, usage, format))
+        {
+            res = compress_image(pool, res, format);
+        }
+
+        if (!write_texture_cache(filename, usage, compress, res))
+            LOG(WARNING) << "Could not write texture cache for " << filename;
+
+        res.decode_time = elapsed();
+        return res;
+    }
+}
+
+texture_streamer::~texture_streamer()
+{
+    release();
+}
+
+void texture_streamer::enqueue(std::shared_ptr<texture> target, const std::string& filename,
+    texture_usage usage, bool compress)
+{
+    job j;
+    j.target = target;
+    auto& pool = _pool;
+    j.image = _pool.submit([&pool, filename, usage, compress]() { 
+        return load_image(pool, filename, usage, compress); 
+    });
+    _jobs.push_back(std::move(j));
+}
+
+void texture_streamer::update(float budget_ms)
+{
+    using namespace std::chrono;
+
+    auto start = high_resolution_clock::now();
+
+    for (auto it = _jobs.begin(); it != _jobs.end();)
+    {
+        if (it->image.wait_for(seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        upload(*it);
+        it = _jobs.erase(it);
+
+        auto elapsed = duration_cast<microseconds>(high_resolution_clock::now() - start);
+        if (elapsed.count() / 1000.f >= budget_ms) break;
+    }
+}
+
+void texture_streamer::finish(const std::shared_ptr<texture>& target)
+{
+    for (auto it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        if (it->target.lock() == target)
+        {
+            upload(*it);
+            _jobs.erase(it);
+            return;
+        }
+    }
+}
+
+void texture_streamer::release()
+{
+    _jobs.clear();
+    if (_pbo)
+    {
+        glDeleteBuffers(1, &_pbo);
+        _pbo = 0;
+    }
+}
+
+void texture_streamer::upload(job& j)
+{
+    texture_image image;
+    try
+    {
+        image = j.image.get();
+    }
+    catch (const std::exception& ex)
+    {
+        LOG(ERROR) << ex.what();
+        return;
+    }
+
+    auto target = j.target.lock();
+    if (!target) return;
+
+    using namespace std::chrono;
+
+    auto start = high_resolution_clock::now();
+
+    if (!_pbo) glGenBuffers(1, &_pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo);
+
+    // Orphaning the old storage lets the driver keep transferring 
+    // the previous texture while this one is being copied in
+    auto size = image.data.size();
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    auto dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    const uint8_t* base = nullptr; // Level offsets are offsets into the bound buffer
+    if (dst)
+    {
+        memcpy(dst, image.data.data(), size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else
+    {
+        LOG(WARNING) << "Could not map the staging buffer, uploading from client memory";
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        base = image.data.data();
+    }
+
+    auto staging = duration_cast<microseconds>(high_resolution_clock::now() - start);
+
+    target->upload(image, base);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    target->set_load_times(image.decode_time, 
+        staging.count() / 1000.f + target->get_upload_time());
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "texture.h"
+#include "worker-pool.h"
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+
+// Decodes texture files on worker threads and uploads them on the GL thread,
+// staged through a pixel buffer object, a few textures per frame.
+// Compressed textures are encoded once and then read from the texture cache
+class texture_streamer
+{
+public:
+    explicit texture_streamer(worker_pool& pool) : _pool(pool) {}
+    ~texture_streamer();
+
+    // The target stays empty until its upload. Jobs whose target 
+    // has been destroyed by then are dropped
+    void enqueue(std::shared_ptr<texture> target, const std::string& filename,
+        texture_usage usage = texture_usage::color, bool compress = false);
+
+    // Uploads decoded textures until budget_ms is spent, at least one per call
+    void update(float budget_ms);
+
+    // Waits for the target to decode and uploads it right away
+    void finish(const std::shared_ptr<texture>& target);
+
+    // Deletes the staging buffer and drops queued jobs, call before the context goes away
+    void release();
+
+    int pending() const { return (int)_jobs.size(); }
+
+private:
+    texture_streamer(const texture_streamer& other) = delete;
+
+    struct job
+    {
+        std::weak_ptr<texture> target;
+        std::future<texture_image> image;
+    };
+
+    void upload(job& j);
+
+    worker_pool& _pool;
+    std::deque<job> _jobs;
+    uint32_t _pbo = 0;
+};
@@ -5,9 +5,58 @@
 
 #include <easylogging++.h>
 
+#include <chrono>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+bool is_compressed(pixel_format format)
+{
+    return format == pixel_format::bc1 ||
+           format == pixel_format::bc3 ||
+           format == pixel_format::bc5;
+}
+
+pixel_format format_for_channels(int channels)
+{
+    switch (channels)
+    {
+    case 1: return pixel_format::r8;
+    case 3: return pixel_format::rgb8;
+    case 4: return pixel_format::rgba8;
+    default: throw std::runtime_error("Unsupported image format!");
+    }
+}
+
+int channel_count(pixel_format format)
+{
+    switch (format)
+    {
+    case pixel_format::r8: return 1;
+    case pixel_format::rgb8: return 3;
+    case pixel_format::rgba8: return 4;
+    case pixel_format::bc1: return 3;
+    case pixel_format::bc3: return 4;
+    case pixel_format::bc5: return 2;
+    default: throw std::runtime_error("Unknown pixel format!");
+    }
+}
+
+size_t level_size(pixel_format format, int width, int height)
+{
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format)
+    {
+    case pixel_format::r8: return (size_t)width * height;
+    case pixel_format::rgb8: return (size_t)width * height * 3;
+    case pixel_format::rgba8: return (size_t)width * height * 4;
+    case pixel_format::bc1: return blocks * 8;
+    case pixel_format::bc3: return blocks * 16;
+    case pixel_format::bc5: return blocks * 16;
+    default: throw std::runtime_error("Unknown pixel format!");
+    }
+}
+
 void texture::bind(int texture_slot) const
 {
     glActiveTexture(GL_TEXTURE0 + texture_slot);
@@ -18,6 +67,35 @@ void texture::set_options(bool linear, bool mipmap)
 {
     _linear = linear;
     _mipmap = mipmap;
+
+    // Storage is kept, only sampling state changes
+    if (_width)
+    {
+        bind(0);
+        apply_filter();
+        unbind();
+    }
+}
+
+void texture::apply_filter()
+{
+    if (_mipmap && !_has_mips && !_compressed)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        _has_mips = true;
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _linear ? GL_LINEAR : GL_NEAREST);
+    if (!_mipmap || !_has_mips)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _linear ? GL_LINEAR : GL_NEAREST);
+    }
+    else
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -1);
+    }
 }
 
 void texture::unbind() const
@@ -35,7 +113,7 @@ texture::~texture()
     glDeleteTextures(1, &_texture);
 }
 
-void texture::upload(const std::string& filename)
+decoded_image decode_image(const std::string& filename)
 {
     using namespace std::chrono;
 
@@ -44,13 +122,22 @@ void texture::upload(const std::string& filename)
     if (!file_exists(filename))
         throw std::runtime_error("Texture file not found!");
 
-    int x, y, comp;
-    auto r = stbi_load(filename.c_str(), &x, &y, &comp, false);
-    upload(comp, 8, x, y, r);
-    stbi_image_free(r);
+    decoded_image res;
+    res.pixels = { stbi_load(filename.c_str(), &res.width, &res.height, &res.channels, false),
+                   stbi_image_free };
+    if (!res.pixels)
+        throw std::runtime_error("Could not decode texture " + filename + "!");
 
     auto duration = (high_resolution_clock::now() - start);
-    _load_time = duration_cast<microseconds>(duration).count() / 1000.f;
+    res.decode_time = duration_cast<microseconds>(duration).count() / 1000.f;
+    return res;
+}
+
+void texture::upload(const std::string& filename)
+{
+    auto image = decode_image(filename);
+    upload(image.channels, 8, image.width, image.height, image.pixels.get());
+    _decode_time = image.decode_time;
 }
 
 void texture::upload(int channels, int bits_per_channel, int width, int height, uint8_t* data)
@@ -61,6 +148,9 @@ void texture::upload(int channels, int bits_per_channel, int width, int height,
 
     auto start = high_resolution_clock::now();
 
+    // Decoded rows are tightly packed, RGB rows are not always a multiple of 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
     if (channels == 3 && bits_per_channel == 8)
     {
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
@@ -83,17 +173,9 @@ void texture::upload(int channels, int bits_per_channel, int width, int height,
     }
     else throw std::runtime_error("Unsupported image format!");
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, _linear ? GL_LINEAR : GL_NEAREST);
-    if (!_mipmap)
-    {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _linear ? GL_LINEAR : GL_NEAREST);
-    }
-    else
-    {
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -1);
-    }
+    _compressed = false;
+    _has_mips = false;
+    apply_filter();
 
     unbind();
 
@@ -101,6 +183,75 @@ void texture::upload(int channels, int bits_per_channel, int width, int height,
     
     _width = width;
     _height = height;
-    _bpp = channels * bits_per_channel / 8;
-    _load_time = duration_cast<microseconds>(duration).count() / 1000.f;
-}
\ No newline at end of file
+    _bytes = width * height * channels * bits_per_channel / 8;
+    _decode_time = 0.f;
+    _upload_time = duration_cast<microseconds>(duration).count() / 1000.f;
+}
+void texture::upload(const texture_image& image)
+{
+    upload(image, image.data.data());
+}
+
+void texture::upload(const texture_image& image, const uint8_t* base)
+{
+    if (image.levels.empty())
+        throw std::runtime_error("Texture image has no levels!");
+
+    bind(0);
+
+    using namespace std::chrono;
+
+    auto start = high_resolution_clock::now();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // Every level is uploaded, so toggling mipmapping later is only a filter change
+    int levels = (int)image.levels.size();
+
+    _bytes = 0;
+    for (int i = 0; i < levels; i++)
+    {
+        auto& l = image.levels[i];
+        auto size = level_size(image.format, l.width, l.height);
+        auto data = base + l.offset;
+
+        switch (image.format)
+        {
+        case pixel_format::r8:
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGB, l.width, l.height, 0, GL_RED, GL_UNSIGNED_BYTE, data);
+            break;
+        case pixel_format::rgb8:
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGB, l.width, l.height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            break;
+        case pixel_format::rgba8:
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, l.width, l.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            break;
+        case pixel_format::bc1:
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, l.width, l.height, 0, size, data);
+            break;
+        case pixel_format::bc3:
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, l.width, l.height, 0, size, data);
+            break;
+        case pixel_format::bc5:
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, GL_COMPRESSED_RG_RGTC2, l.width, l.height, 0, size, data);
+            break;
+        default: throw std::runtime_error("Unsupported image format!");
+        }
+        _bytes += (int)size;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    // Block compressed textures can not be mipmapped by the driver
+    _compressed = is_compressed(image.format);
+    _has_mips = levels > 1;
+    apply_filter();
+
+    unbind();
+
+    auto duration = (high_resolution_clock::now() - start);
+
+    _width = image.levels[0].width;
+    _height = image.levels[0].height;
+    _decode_time = image.decode_time;
+    _upload_time = duration_cast<microseconds>(duration).count() / 1000.f;
+}
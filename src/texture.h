@@ -1,6 +1,64 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+// Pixels decoded on the CPU, tightly packed with 8 bits per channel
+struct decoded_image
+{
+    int width = 0, height = 0, channels = 0;
+    std::unique_ptr<uint8_t, void(*)(void*)> pixels{ nullptr, free };
+    float decode_time = 0.f;
+
+    size_t size() const { return (size_t)width * height * channels; }
+};
+
+// Reads and decodes an image file. Does not touch OpenGL, safe to call from any thread
+decoded_image decode_image(const std::string& filename);
+
+// What a texture is sampled for, normal maps only need two channels
+enum class texture_usage
+{
+    color = 0,
+    normal_map = 1,
+};
+
+enum class pixel_format
+{
+    r8 = 0,
+    rgb8 = 1,
+    rgba8 = 2,
+    bc1 = 3, // RGB, 8 bytes per 4x4 block
+    bc3 = 4, // RGBA, 16 bytes per 4x4 block
+    bc5 = 5, // Two channels, 16 bytes per 4x4 block
+};
+
+bool is_compressed(pixel_format format);
+
+// Uncompressed format for 8-bit images with the given channel count
+pixel_format format_for_channels(int channels);
+int channel_count(pixel_format format);
+
+// Bytes taken by one mip level, block formats round up to whole 4x4 blocks
+size_t level_size(pixel_format format, int width, int height);
+
+struct mip_level
+{
+    int width = 0, height = 0;
+    size_t offset = 0; // Into texture_image::data
+};
+
+// CPU-side texture contents, mip levels stored back to back starting from the largest
+struct texture_image
+{
+    pixel_format format = pixel_format::rgba8;
+    std::vector<mip_level> levels;
+    std::vector<uint8_t> data;
+    float decode_time = 0.f;
+};
 
 class texture
 {
@@ -11,6 +69,12 @@ public:
     void upload(const std::string& filename);
     void upload(int channels, int bits_per_channel, int width, int height, uint8_t* data);
 
+    // Pixels are read from image.data, unless base is given. With a pixel unpack
+    // buffer bound, base is nullptr and level offsets are offsets into the buffer.
+    // Uncompressed single level images get their mip chain from glGenerateMipmap when needed
+    void upload(const texture_image& image);
+    void upload(const texture_image& image, const uint8_t* base);
+
     void bind(int texture_slot) const;
     void unbind() const;
 
@@ -18,15 +82,29 @@ public:
 
     int get_width() const { return _width; }
     int get_height() const { return _height; }
-    int get_bytes() const { return _width*_height*_bpp; }
-    float get_load_time() const { return _load_time; }
+    int get_bytes() const { return _bytes; }
+    bool has_mips() const { return _has_mips; }
+    float get_load_time() const { return _decode_time + _upload_time; }
+    float get_decode_time() const { return _decode_time; }
+    float get_upload_time() const { return _upload_time; }
+
+    // For uploads staged elsewhere, where decoding and copying are timed by the caller
+    void set_load_times(float decode_ms, float upload_ms)
+    {
+        _decode_time = decode_ms;
+        _upload_time = upload_ms;
+    }
 
+    // Filtering used when the texture is bound without a sampler object.
+    // Applies to the current contents right away, without a re-upload
     void set_options(bool linear, bool mipmap);
 
 private:
+    void apply_filter(); // On the bound texture
     uint32_t _texture;
     bool _mipmap = true;
     bool _linear = true;
-    int _width = 0, _height = 0, _bpp = 0;
-    float _load_time = 0.;
-};
\ No newline at end of file
+    bool _has_mips = false, _compressed = false;
+    int _width = 0, _height = 0, _bytes = 0;
+    float _decode_time = 0.f, _upload_time = 0.f;
+};
@@ -6,44 +6,63 @@
 #include <memory>
 #include <map>
 #include <vector>
+#include <algorithm>
 
 #include "texture.h"
+#include "texture-streamer.h"
+#include "sampler-cache.h"
 
 
 class texture_object
 {
 public:
     texture_object(std::string name, 
-        std::string filename)
-        : _name(std::move(name)), _filename(std::move(filename))
+        std::string filename, texture_usage usage = texture_usage::color)
+        : _name(std::move(name)), _filename(std::move(filename)), _usage(usage)
     {
         _tex = std::make_shared<texture>();
     }
 
     texture& get() { return *_tex; }
+    const std::shared_ptr<texture>& get_shared() const { return _tex; }
 
     const std::string& get_name() const { return _name; }
+    const std::string& get_filename() const { return _filename; }
+    texture_usage get_usage() const { return _usage; }
 
     void release() { _tex.reset(); }
 
-    void reload()
+    // Replaces the texture with an empty one using the current options,
+    // the file contents are uploaded by the texture streamer
+    void reset()
     {
         _tex = std::make_shared<texture>();
-        if (_filename != "")
-        {
-            _tex->set_options(_linear, _mipmap);
-            _tex->upload(_filename);
-        }
+        _tex->set_options(_linear, _mipmap);
+        _evicted = false;
+    }
+
+    // Frees the texture memory, only for textures that can be reloaded from their file
+    void evict()
+    {
+        reset();
+        _evicted = true;
     }
 
+    bool evicted() const { return _evicted; }
+    uint64_t& last_used() { return _last_used; }
+
     bool& linear() { return _linear; }
     bool& mipmap() { return _mipmap; }
+    bool& compress() { return _compress; }
     bool& is_open() { return _is_open; }
 private:
     std::shared_ptr<texture> _tex;
     std::string _name, _filename = "";
+    texture_usage _usage;
 
-    bool _linear = true, _mipmap = true, _is_open = false;
+    bool _linear = true, _mipmap = true, _compress = true, _is_open = false;
+    bool _evicted = false;
+    uint64_t _last_used = 0; // Frame number
 };
 
 class texture_handle
@@ -60,9 +79,12 @@ private:
 class textures
 {
 public:
-    texture_handle add_texture(std::string name, std::string filename)
+    explicit textures(worker_pool& pool) : _streamer(pool) {}
+
+    texture_handle add_texture(std::string name, std::string filename,
+        texture_usage usage = texture_usage::color)
     {
-        tos.emplace_back(name, filename);
+        tos.emplace_back(name, filename, usage);
         return tos.size() - 1;
     }
     texture_handle add_texture(std::string name)
@@ -70,27 +92,117 @@ public:
         return add_texture(name, "");
     }
 
+    // Binds the texture together with the sampler for the object's filtering options.
+    // Evicted textures are queued for reloading and stay empty until streamed back in
     template<class T>
     void with_texture(texture_handle tex_id, int slot, T action)
     {
-        auto& tex = tos[tex_id.get_index()].get();
+        auto& to = tos[tex_id.get_index()];
+        touch(to);
+
+        auto& tex = to.get();
         tex.bind(slot);
+        _samplers.bind(slot, to.linear(), to.mipmap() && tex.has_mips());
         action();
+        sampler_cache::unbind(slot);
         tex.unbind();
     }
 
+    // Marks the texture as used this frame, for anything drawing it without with_texture
+    void touch(texture_object& to)
+    {
+        to.last_used() = _frame;
+        if (to.evicted()) reload(to);
+    }
+    void touch(texture_handle tex_id) { touch(tos[tex_id.get_index()]); }
+
     texture& get(texture_handle tex_id)
     {
         return tos[tex_id.get_index()].get();
     }
 
+    void reload(texture_object& to)
+    {
+        to.reset();
+        if (to.get_filename() != "")
+            _streamer.enqueue(to.get_shared(), to.get_filename(), 
+                to.get_usage(), to.compress());
+    }
+
     void reload_all()
     {
         for (auto& to : tos)
-            to.reload();
+            reload(to);
+    }
+
+    // Streams queued textures in, call once per frame
+    void update(float budget_ms) { _streamer.update(budget_ms); }
+
+    // For textures that are needed before the next frame
+    void finish(texture_handle tex_id)
+    {
+        _streamer.finish(tos[tex_id.get_index()].get_shared());
+    }
+
+    int pending() const { return _streamer.pending(); }
+
+    // Residency: once per frame, textures that can be reloaded from disk are evicted,
+    // least recently used first, until the resident total fits the budget.
+    // Anything used in the last two frames is kept, to avoid reloading every frame
+    void begin_frame()
+    {
+        _frame++;
+
+        auto total = resident_bytes();
+        if (total <= _budget) return;
+
+        std::vector<texture_object*> candidates;
+        for (auto& to : tos)
+        {
+            if (to.get_filename() != "" && !to.evicted() && 
+                to.get().get_bytes() > 0 && _frame - to.last_used() >= 2)
+            {
+                candidates.push_back(&to);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), 
+            [](texture_object* a, texture_object* b) { return a->last_used() < b->last_used(); });
+
+        for (auto to : candidates)
+        {
+            if (total <= _budget) break;
+            total -= to->get().get_bytes();
+            to->evict();
+            _evictions++;
+        }
+    }
+
+    size_t resident_bytes()
+    {
+        size_t total = 0;
+        for (auto& to : tos)
+            total += to.get().get_bytes();
+        return total;
+    }
+
+    size_t& budget() { return _budget; }
+    int evictions() const { return _evictions; }
+
+    void release_all()
+    {
+        _streamer.release();
+        _samplers.release();
+        for (auto& to : tos)
+            to.release();
     }
 
     std::vector<texture_object>& get_texture_objects() { return tos; }
 private:
     std::vector<texture_object> tos;
+    texture_streamer _streamer;
+    sampler_cache _samplers;
+
+    uint64_t _frame = 0;
+    size_t _budget = (size_t)256 << 20;
+    int _evictions = 0;
 };
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "tube-grid.h"
+
+#include <algorithm>
+
+const int tube_grid::chunk_size;
+
+namespace
+{
+    // Division rounding towards negative infinity
+    int floor_div(int a, int b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+}
+
+int2 tube_grid::chunk_of(const int2& cell)
+{
+    return { floor_div(cell.x, chunk_size), floor_div(cell.y, chunk_size) };
+}
+
+uint64_t tube_grid::key(const int2& chunk_pos)
+{
+    return ((uint64_t)(uint32_t)chunk_pos.x << 32) | (uint32_t)chunk_pos.y;
+}
+
+const tube_grid::chunk* tube_grid::get_chunk(const int2& chunk_pos) const
+{
+    auto it = _chunks.find(key(chunk_pos));
+    return it == _chunks.end() ? nullptr : &it->second;
+}
+
+int tube_grid::find(const int2& cell) const
+{
+    auto c = get_chunk(chunk_of(cell));
+    if (!c) return -1;
+    auto local = cell - c->origin;
+    return c->cells[local.y * chunk_size + local.x];
+}
+
+bool tube_grid::insert(const int2& cell, int index)
+{
+    auto chunk_pos = chunk_of(cell);
+    auto it = _chunks.find(key(chunk_pos));
+    if (it == _chunks.end())
+    {
+        chunk c;
+        c.origin = chunk_pos * chunk_size;
+        std::fill(std::begin(c.cells), std::end(c.cells), -1);
+        it = _chunks.emplace(key(chunk_pos), c).first;
+    }
+
+    auto& c = it->second;
+    auto local = cell - c.origin;
+    auto& slot = c.cells[local.y * chunk_size + local.x];
+    if (slot >= 0) return false;
+
+    slot = index;
+    c.count++;
+    _size++;
+    return true;
+}
+
+void tube_grid::erase(const int2& cell)
+{
+    auto it = _chunks.find(key(chunk_of(cell)));
+    if (it == _chunks.end()) return;
+
+    auto& c = it->second;
+    auto local = cell - c.origin;
+    auto& slot = c.cells[local.y * chunk_size + local.x];
+    if (slot < 0) return;
+
+    slot = -1;
+    _size--;
+    if (--c.count == 0) _chunks.erase(it);
+}
+
+void tube_grid::clear()
+{
+    _chunks.clear();
+    _size = 0;
+}
+
+void tube_grid::query_rect(const int2& lo, const int2& hi, std::vector<int>& out) const
+{
+    auto clo = chunk_of(lo);
+    auto chi = chunk_of(hi);
+
+    auto visit = [&](const chunk& c) {
+        auto from = max(lo, c.origin);
+        auto to = min(hi, c.origin + int2{ chunk_size - 1, chunk_size - 1 });
+        for (int y = from.y; y <= to.y; y++)
+            for (int x = from.x; x <= to.x; x++)
+            {
+                auto idx = c.cells[(y - c.origin.y) * chunk_size + (x - c.origin.x)];
+                if (idx >= 0) out.push_back(idx);
+            }
+    };
+
+    // Large rectangles over a sparse grid: walk the existing chunks instead
+    auto span = (int64_t)(chi.x - clo.x + 1) * (chi.y - clo.y + 1);
+    if (span > (int64_t)_chunks.size())
+    {
+        for (auto& kvp : _chunks)
+        {
+            auto pos = chunk_of(kvp.second.origin);
+            if (pos.x >= clo.x && pos.x <= chi.x && pos.y >= clo.y && pos.y <= chi.y)
+                visit(kvp.second);
+        }
+        return;
+    }
+
+    for (int y = clo.y; y <= chi.y; y++)
+        for (int x = clo.x; x <= chi.x; x++)
+            if (auto c = get_chunk({ x, y })) visit(*c);
+}
+
+void tube_grid::query_frustum(const frustum& f, std::vector<int>& out) const
+{
+    for (auto& kvp : _chunks)
+    {
+        auto& c = kvp.second;
+        float3 lo{ (float)c.origin.x, 0.f, (float)c.origin.y };
+        float3 hi = lo + float3{ chunk_size - 1.f, 0.f, chunk_size - 1.f };
+        if (f.intersects(lo + _cell_lo, hi + _cell_hi))
+            for_each(c, [&](int idx) { out.push_back(idx); });
+    }
+}
+
+void tube_grid::neighbours(const int2& cell, std::vector<int>& out) const
+{
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+        {
+            if (x == 0 && y == 0) continue;
+            auto idx = find(cell + int2{ x, y });
+            if (idx >= 0) out.push_back(idx);
+        }
+}
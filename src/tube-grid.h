@@ -0,0 +1,64 @@
+#pragma once
+
+#include "util.h"
+#include "frustum.h"
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+// Spatial index over grid cells, mapping every occupied cell to one item index.
+// Cells are grouped into fixed size chunks stored in a hash map, 
+// so lookups are O(1) and region queries only visit chunks that exist
+class tube_grid
+{
+public:
+    static const int chunk_size = 16;
+
+    // Index stored at the cell, or -1 if the cell is empty
+    int find(const int2& cell) const;
+    bool occupied(const int2& cell) const { return find(cell) >= 0; }
+
+    // Returns false (and changes nothing) if the cell is already occupied
+    bool insert(const int2& cell, int index);
+    void erase(const int2& cell);
+    void clear();
+
+    // Items inside [lo, hi], both inclusive
+    void query_rect(const int2& lo, const int2& hi, std::vector<int>& out) const;
+    // Items of every chunk intersecting the frustum, refine per item if needed
+    void query_frustum(const frustum& f, std::vector<int>& out) const;
+    // Items in the 8 cells surrounding the cell
+    void neighbours(const int2& cell, std::vector<int>& out) const;
+
+    // World-space extent of anything placed in a cell, relative to the cell position.
+    // Cell (x, y) maps to world (x, 0, y)
+    void set_cell_bounds(const float3& lo, const float3& hi) { _cell_lo = lo; _cell_hi = hi; }
+
+    int size() const { return _size; }
+    int chunk_count() const { return (int)_chunks.size(); }
+
+private:
+    struct chunk
+    {
+        int2 origin;
+        int count = 0;
+        int cells[chunk_size * chunk_size];
+    };
+
+    static int2 chunk_of(const int2& cell);
+    static uint64_t key(const int2& chunk_pos);
+
+    const chunk* get_chunk(const int2& chunk_pos) const;
+
+    template<class F>
+    void for_each(const chunk& c, F f) const
+    {
+        for (int i = 0; i < chunk_size * chunk_size; i++)
+            if (c.cells[i] >= 0) f(c.cells[i]);
+    }
+
+    std::unordered_map<uint64_t, chunk> _chunks;
+    int _size = 0;
+    float3 _cell_lo{ -1.f, -1.f, -1.f }, _cell_hi{ 1.f, 1.f, 1.f };
+};
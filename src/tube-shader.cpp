@@ -1,56 +1,87 @@
 #include "tube-shader.h"
 
+namespace
+{
+    const char* vertex_shader = "resources/shaders/tube/tube-vertex.glsl";
+    const char* fragment_shader = "resources/shaders/tube/tube-fragment.glsl";
+
+    std::vector<std::string> feature_defines(int features)
+    {
+        std::vector<std::string> res;
+        if (features & tube_shader::normal_mapping) res.push_back("NORMAL_MAPPING");
+        if (features & tube_shader::damaged) res.push_back("DAMAGED");
+        if (features & tube_shader::refraction) res.push_back("REFRACTION");
+        return res;
+    }
+}
+
 tube_shader::tube_shader()
-    : simple_shader(shader_program::load(
-        "resources/shaders/tube/tube-vertex.glsl",
-        "resources/shaders/tube/tube-fragment.glsl"))
+    : simple_shader(shader_registry::current().get(vertex_shader, fragment_shader,
+        feature_defines(permutations - 1))),
+      _features(permutations - 1)
 {
-    _shine2_location = _shader->get_uniform_location("shineDamper2");
-    _reflectivity2_location = _shader->get_uniform_location("reflectivity2");
-    _distortion_location = _shader->get_uniform_location("distortion");
-    _do_normal_mapping_location = _shader->get_uniform_location("do_normal_mapping");
-    _decal_uvs_location = _shader->get_uniform_location("decal_uvs");
-    _decal_id_location = _shader->get_uniform_location("decal_id");
-    _decal_variations_locations = _shader->get_uniform_location("decal_variations");
-
-    auto normalsSampler_location = _shader->get_uniform_location("textureNormalSampler");
-    auto refractionSampler_location = _shader->get_uniform_location("refractionSampler");
-    auto destructionSample_location = _shader->get_uniform_location("destructionSampler");
-    auto glassSampler_location = _shader->get_uniform_location("glassSampler");
+    // The full variant is already current, every other one is fetched once
+    for (int i = 0; i < permutations; i++)
+    {
+        auto& v = _variants[i];
+        v.program = i == _features ? _shader : 
+            shader_registry::current().get(vertex_shader, fragment_shader, feature_defines(i));
+        prepare(*v.program);
 
-    _shader->begin();
-    _shader->load_uniform(normalsSampler_location, normal_map_slot());
-    _shader->load_uniform(refractionSampler_location, refraction_slot());
-    _shader->load_uniform(destructionSample_location, decal_atlas_slot());
-    _shader->load_uniform(glassSampler_location, glass_atlas_slot());
-    _shader->end();
+        v.model_location = v.program->get_uniform_location("transformationMatrix");
+        v.decal_variations_location = v.program->get_uniform_location("decal_variations");
+        v.instanced_location = v.program->get_uniform_location("instanced");
+
+        auto normalsSampler_location = v.program->get_uniform_location("textureNormalSampler");
+        auto refractionSampler_location = v.program->get_uniform_location("refractionSampler");
+        auto destructionSample_location = v.program->get_uniform_location("destructionSampler");
+        auto glassSampler_location = v.program->get_uniform_location("glassSampler");
+
+        v.program->begin();
+        v.program->load_uniform(normalsSampler_location, normal_map_slot());
+        v.program->load_uniform(refractionSampler_location, refraction_slot());
+        v.program->load_uniform(destructionSample_location, decal_atlas_slot());
+        v.program->load_uniform(glassSampler_location, glass_atlas_slot());
+        v.program->end();
+    }
 }
 
-void tube_shader::enable_normal_mapping(bool enabled)
+void tube_shader::select(int features)
 {
-    _shader->load_uniform(_do_normal_mapping_location, enabled ? 1.f : 0.f);
+    if (features == _features) return;
+    _features = features;
+
+    auto& v = _variants[features];
+    _shader = v.program;
+    _transformation_matrix_location = v.model_location;
+
+    _shader->begin();
+    load_state();
 }
 
-void tube_shader::set_distortion(float d)
+void tube_shader::load_state()
 {
-    _shader->load_uniform(_distortion_location, d);
+    // Redundant values are filtered out by the uniform shadow of each program
+    auto& v = _variants[_features];
+    _shader->load_uniform(v.instanced_location, _instanced ? 1.f : 0.f);
+    _shader->load_uniform(v.decal_variations_location, _decal_variations);
 }
 
-void tube_shader::set_material_properties(
-    float ambient, float shine, float reflectivity)
+void tube_shader::enable_instancing(bool enabled)
 {
-    simple_shader::set_material_properties(ambient, shine, reflectivity);
-    _shader->load_uniform(_shine2_location, shine * 2);
-    _shader->load_uniform(_reflectivity2_location, reflectivity * 2);
+    _instanced = enabled;
+    _shader->load_uniform(_variants[_features].instanced_location, enabled ? 1.f : 0.f);
 }
 
-void tube_shader::set_decal_uvs(const float2 & uvs)
+void tube_shader::set_distortion(float d)
 {
-    _shader->load_uniform(_decal_uvs_location, uvs);
+    auto material = _material.get();
+    material.distortion = d;
+    _material.set(material);
 }
 
-void tube_shader::set_decal_id(int decal, int variations)
+void tube_shader::set_decal_variations(int variations)
 {
-    _shader->load_uniform(_decal_id_location, decal);
-    _shader->load_uniform(_decal_variations_locations, variations);
+    _decal_variations = variations;
+    _shader->load_uniform(_variants[_features].decal_variations_location, variations);
 }
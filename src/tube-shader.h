@@ -3,20 +3,31 @@
 #include "util.h"
 #include "simple-shader.h"
 
+// Every combination of features is compiled into its own specialized program,
+// select() switches between them at draw time
 class tube_shader : public simple_shader
 {
 public:
+    // Compile-time features, ORed into a permutation key
+    static const int normal_mapping = 1;
+    static const int damaged = 2;       // Samples the decal atlases
+    static const int refraction = 4;    // Blends in the refraction pass
+    static const int permutations = 8;
+
     tube_shader();
 
-    void enable_normal_mapping(bool enabled);
+    // Makes the variant current, call between begin() and end().
+    // Instancing and decal state carry over, the model matrix has to be set again
+    void select(int features);
+    int features() const { return _features; }
 
-    void set_distortion(float d);
+    // When enabled, model matrix and decal parameters come from per-instance attributes
+    void enable_instancing(bool enabled);
 
-    void set_material_properties(float ambient,
-        float shine, float reflectivity) override;
+    void set_distortion(float d);
 
-    void set_decal_uvs(const float2& uvs);
-    void set_decal_id(int decal, int variations);
+    // Decal atlases hold variations x variations decals
+    void set_decal_variations(int variations);
 
     int normal_map_slot() const { return 1; }
     int refraction_slot() const { return 2; }
@@ -24,11 +35,19 @@ public:
     int glass_atlas_slot() const { return 4; }
 
 private:
-    uint32_t _shine2_location;
-    uint32_t _reflectivity2_location;
-    uint32_t _distortion_location;
-    uint32_t _do_normal_mapping_location;
-    uint32_t _decal_uvs_location;
-    uint32_t _decal_id_location;
-    uint32_t _decal_variations_locations;
-};
\ No newline at end of file
+    struct variant
+    {
+        std::shared_ptr<shader_program> program;
+        uint32_t model_location;
+        uint32_t decal_variations_location;
+        uint32_t instanced_location;
+    };
+
+    void load_state();
+
+    variant _variants[permutations];
+    int _features;
+
+    bool _instanced = false;
+    int _decal_variations = 1;
+};
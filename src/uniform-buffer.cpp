@@ -0,0 +1,35 @@
+#include "uniform-buffer.h"
+
+#include <GL/gl3w.h>
+#include <string.h>
+
+uniform_buffer::uniform_buffer(int bytes)
+    : _contents(bytes)
+{
+    glGenBuffers(1, &_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, _id);
+    glBufferData(GL_UNIFORM_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+uniform_buffer::~uniform_buffer()
+{
+    glDeleteBuffers(1, &_id);
+}
+
+void uniform_buffer::update(const void* data)
+{
+    if (_valid && memcmp(_contents.data(), data, _contents.size()) == 0) return;
+
+    memcpy(_contents.data(), data, _contents.size());
+    _valid = true;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _id);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, _contents.size(), data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void uniform_buffer::bind(uniform_binding binding) const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, (int)binding, _id);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "util.h"
+
+#include <vector>
+
+// Binding points of the uniform blocks declared in resources/shaders
+enum class uniform_binding
+{
+    frame = 0,
+    material = 1,
+};
+
+// std140 layout of the FrameData block, vec3 members are padded to vec4.
+// Written once per frame and read by every program
+struct frame_data
+{
+    float4x4 view;
+    float4x4 projection;
+    float4 camera_position;
+    float4 light_position;
+    float4 light_colour;
+};
+
+// std140 layout of the Material block
+struct material_data
+{
+    float ambient = 0.f;
+    float shine = 1.f;
+    float reflectivity = 0.f;
+    float distortion = 0.f;
+};
+
+class uniform_buffer
+{
+public:
+    uniform_buffer(int bytes);
+    ~uniform_buffer();
+
+    // Skips the upload when the data matches what the buffer already holds
+    void update(const void* data);
+
+    void bind(uniform_binding binding) const;
+
+private:
+    uniform_buffer(const uniform_buffer& other) = delete;
+
+    uint32_t _id;
+    std::vector<uint8_t> _contents;
+    bool _valid = false;
+};
+
+template<class T>
+class uniform_block : public uniform_buffer
+{
+public:
+    uniform_block() : uniform_buffer(sizeof(T)) {}
+
+    void set(const T& value)
+    {
+        _value = value;
+        update(&_value);
+    }
+
+    const T& get() const { return _value; }
+
+private:
+    T _value;
+};
@@ -2,6 +2,8 @@
 
 #include <fstream>
 #include <vector>
+#include <string.h>
+#include <sys/stat.h>
 
 #include <easylogging++.h>
 
@@ -70,6 +72,60 @@ float4x4 identity_matrix()
     return data;
 }
 
+uint16_t float_to_half(float value)
+{
+    uint32_t x;
+    memcpy(&x, &value, sizeof(x));
+
+    uint32_t sign = (x >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = x & 0x7fffff;
+
+    if (((x >> 23) & 0xff) == 0xff) // Inf / NaN
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31) // Overflow to Inf
+        return (uint16_t)(sign | 0x7c00);
+    if (exponent <= 0) // Denormals and underflow
+    {
+        if (exponent < -10) return (uint16_t)sign;
+        mantissa |= 0x800000;
+        auto shift = 14 - exponent;
+        auto half = (uint16_t)(mantissa >> shift);
+        if ((mantissa >> (shift - 1)) & 1) half++;
+        return (uint16_t)(sign | half);
+    }
+
+    auto half = (uint16_t)(sign | (exponent << 10) | (mantissa >> 13));
+    if (mantissa & 0x1000) half++; // Carry may correctly round into the exponent
+    return half;
+}
+
+float half_to_float(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+
+    uint32_t x;
+    if (exponent == 0)
+    {
+        if (mantissa == 0) x = sign;
+        else
+        {
+            // Normalize the denormal
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400)) { mantissa <<= 1; exponent--; }
+            x = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    }
+    else if (exponent == 31) x = sign | 0x7f800000 | (mantissa << 13);
+    else x = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+    float res;
+    memcpy(&res, &x, sizeof(res));
+    return res;
+}
+
 std::string read_all_text(const std::string& filename)
 {
     if (!file_exists(filename))
@@ -87,4 +143,13 @@ std::string read_all_text(const std::string& filename)
 bool file_exists(const std::string& name) {
     std::ifstream f(name.c_str());
     return f.good();
-}
\ No newline at end of file
+}
+
+bool file_stamp(const std::string& name, uint64_t& size, int64_t& mtime)
+{
+    struct stat st;
+    if (stat(name.c_str(), &st) != 0) return false;
+    size = (uint64_t)st.st_size;
+    mtime = (int64_t)st.st_mtime;
+    return true;
+}
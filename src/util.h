@@ -3,6 +3,7 @@
 #include <string>
 
 #include <sstream>
+#include <stdint.h>
 
 #include <linalg.h>
 
@@ -50,6 +51,13 @@ float4x4 create_perspective_projection_matrix(float width, float height, float f
 float4x4 create_orthographic_projection_matrix(float width, float height, float fov, float n, float f);
 float4x4 identity_matrix();
 
+// IEEE 754 binary16 conversion, rounding to nearest
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t value);
+
 std::string read_all_text(const std::string& filename);
 bool file_exists(const std::string& name);
+
+// Size and modification time, used to tell whether files derived from this one are stale
+bool file_stamp(const std::string& name, uint64_t& size, int64_t& mtime);
 std::string get_directory(const std::string& fname);
\ No newline at end of file
@@ -1,42 +1,157 @@
 #include "vao.h"
+#include "mesh-cache.h"
 
 #include <easylogging++.h>
 
-vao::vao(const float3* vert, const float2* uvs, const float3* normals,
-         const float3* tangents, int vert_count, const int3* indx, int indx_count)
+#include <algorithm>
+#include <cmath>
+#include <stddef.h>
+
+vao::vao(const mesh_view& mesh, vertex_format format)
+    : _vertexes(vbo_type::array_buffer),
+      _indexes(vbo_type::element_array_buffer),
+      _has_uvs(mesh.uvs != nullptr),
+      _has_normals(mesh.normals != nullptr),
+      _has_tangents(mesh.tangents != nullptr)
+{
+    glGenVertexArrays(1, &_id);
+    bind();
+    _indexes.upload(mesh.indexes, mesh.triangle_count);
+
+    if (format == vertex_format::compact) upload_compact(mesh);
+    else upload_full(mesh);
+    unbind();
+}
+
+vao::vao(const packed_mesh& mesh)
     : _vertexes(vbo_type::array_buffer),
-      _uvs(vbo_type::array_buffer),
       _indexes(vbo_type::element_array_buffer),
-      _tangents(vbo_type::array_buffer)
+      _has_uvs(mesh.layout.uvs),
+      _has_normals(mesh.layout.normals),
+      _has_tangents(mesh.layout.tangents)
 {
     glGenVertexArrays(1, &_id);
     bind();
-    _indexes.upload(indx, indx_count);
-    _vertexes.upload(0, (float*)vert, 3, vert_count);
-    if (normals) _normals.upload(2, (float*)normals, 3, vert_count);
-    if (tangents) _tangents.upload(3, (float*)tangents, 3, vert_count);
-    if (uvs) _uvs.upload(1, (float*)uvs, 2, vert_count);
+    _indexes.upload_indexes(mesh.indexes, mesh.triangle_count, mesh.short_indexes);
+    _vertexes.upload(mesh.vertices, mesh.layout.stride(), mesh.vertex_count);
+    set_full_attributes(mesh.layout);
     unbind();
 }
 
-std::unique_ptr<vao> vao::create(const obj_mesh& mesh)
+void vao::upload_full(const mesh_view& mesh)
+{
+    // All attributes share one interleaved buffer, filled in a single pass
+    auto layout = mesh.layout();
+    auto stride = layout.stride();
+    auto dst = (float*)_vertexes.map(mesh.vertex_count * stride * (int)sizeof(float), 
+        mesh.vertex_count);
+    if (dst) mesh.interleave(dst);
+    _vertexes.unmap();
+
+    set_full_attributes(layout);
+}
+
+void vao::set_full_attributes(const vertex_layout& layout)
 {
-    return std::make_unique<vao>(mesh.positions.data(),
-        mesh.uvs.data(),
-        mesh.normals.data(),
-        mesh.tangents.data(),
-        mesh.positions.size(),
-        mesh.indexes.data(),
-        mesh.indexes.size());
+    auto stride = layout.stride();
+    _vertexes.set_attribute(0, 3, stride, layout.offset(vertex_attribute::position));
+    if (_has_uvs) _vertexes.set_attribute(1, 2, stride, layout.offset(vertex_attribute::uv));
+    if (_has_normals) _vertexes.set_attribute(2, 3, stride, layout.offset(vertex_attribute::normal));
+    if (_has_tangents) _vertexes.set_attribute(3, layout.tangent_signs ? 4 : 3, 
+        stride, layout.offset(vertex_attribute::tangent));
+}
+
+namespace
+{
+    #pragma pack(push, 1)
+    struct compact_vertex
+    {
+        uint16_t position[4];
+        uint16_t uv[2];
+        uint32_t normal;
+        uint16_t tangent[4];
+    };
+    #pragma pack(pop)
+    static_assert(sizeof(compact_vertex) == 24, "Unexpected compact vertex size");
+
+    uint32_t pack_snorm_10(float v)
+    {
+        v = std::max(-1.f, std::min(1.f, v));
+        return (uint32_t)(int32_t)std::round(v * 511.f) & 0x3ff;
+    }
+
+    uint32_t pack_normal(const float3& n)
+    {
+        auto len = length(n);
+        auto u = len > 0.f ? n / len : float3{ 0.f, 0.f, 1.f };
+        return pack_snorm_10(u.x) | 
+              (pack_snorm_10(u.y) << 10) | 
+              (pack_snorm_10(u.z) << 20);
+    }
+}
+
+void vao::upload_compact(const mesh_view& mesh)
+{
+    // Tangents keep their length (tube shader derives decal scale from it)
+    // and are stored as half-floats, normals only need a direction.
+    // Every field is written, the mapped buffer starts out undefined
+    const int stride = sizeof(compact_vertex);
+    auto data = (compact_vertex*)_vertexes.map(mesh.vertex_count * stride, mesh.vertex_count);
+    for (int i = 0; i < mesh.vertex_count; i++)
+    {
+        compact_vertex v = {};
+        auto& p = mesh.positions[i];
+        v.position[0] = float_to_half(p.x);
+        v.position[1] = float_to_half(p.y);
+        v.position[2] = float_to_half(p.z);
+        v.position[3] = float_to_half(1.f);
+        if (_has_uvs)
+        {
+            v.uv[0] = float_to_half(mesh.uvs[i].x);
+            v.uv[1] = float_to_half(mesh.uvs[i].y);
+        }
+        if (_has_normals) v.normal = pack_normal(mesh.normals[i]);
+        if (_has_tangents)
+        {
+            auto& t = mesh.tangents[i];
+            v.tangent[0] = float_to_half(t.x);
+            v.tangent[1] = float_to_half(t.y);
+            v.tangent[2] = float_to_half(t.z);
+            v.tangent[3] = float_to_half(mesh.tangent_signs ? mesh.tangent_signs[i] : 1.f);
+        }
+        data[i] = v;
+    }
+    _vertexes.unmap();
+
+    _vertexes.set_attribute(0, 3, attribute_type::half_float, stride, offsetof(compact_vertex, position));
+    if (_has_uvs) _vertexes.set_attribute(1, 2, attribute_type::half_float, stride, offsetof(compact_vertex, uv));
+    if (_has_normals) _vertexes.set_attribute(2, 4, attribute_type::int_2_10_10_10, stride, offsetof(compact_vertex, normal));
+    if (_has_tangents) _vertexes.set_attribute(3, 4, attribute_type::half_float, stride, offsetof(compact_vertex, tangent));
+}
+
+std::unique_ptr<vao> vao::create(const mesh_view& mesh, vertex_format format)
+{
+    return std::make_unique<vao>(mesh, format);
+}
+
+std::unique_ptr<vao> vao::create(const packed_mesh& mesh)
+{
+    return std::make_unique<vao>(mesh);
+}
+
+std::unique_ptr<vao> vao::create(loader& l, int index)
+{
+    if (auto cache = l.cache()) return create(cache->mesh(index));
+    return create(l.get().at(index));
 }
 
 vao::vao(vao&& other)
     : _id(other._id), 
       _indexes(std::move(other._indexes)),
       _vertexes(std::move(other._vertexes)),
-      _uvs(std::move(other._uvs)),
-      _normals(std::move(other._normals)),
-      _tangents(std::move(other._tangents))
+      _has_uvs(other._has_uvs),
+      _has_normals(other._has_normals),
+      _has_tangents(other._has_tangents)
 {
     other._id = 0;
 }
@@ -57,20 +172,26 @@ void vao::unbind()
 }
 
 void vao::draw()
+{
+    draw_instanced(1);
+}
+
+void vao::draw_instanced(int instances)
 {
     bind();
 
     glEnableVertexAttribArray(0); // vertex
-    if (_uvs.size())        glEnableVertexAttribArray(1); // uv
-    if (_normals.size())    glEnableVertexAttribArray(2); // normals
-    if (_tangents.size())   glEnableVertexAttribArray(3); // tangents
+    if (_has_uvs)       glEnableVertexAttribArray(1); // uv
+    if (_has_normals)   glEnableVertexAttribArray(2); // normals
+    if (_has_tangents)  glEnableVertexAttribArray(3); // tangents
     
-    _indexes.draw_indexed_triangles();
+    if (instances == 1) _indexes.draw_indexed_triangles();
+    else _indexes.draw_indexed_triangles_instanced(instances);
     
     glDisableVertexAttribArray(0);
-    if (_uvs.size())        glDisableVertexAttribArray(1);
-    if (_normals.size())    glDisableVertexAttribArray(2);
-    if (_tangents.size())   glDisableVertexAttribArray(3);
+    if (_has_uvs)       glDisableVertexAttribArray(1);
+    if (_has_normals)   glDisableVertexAttribArray(2);
+    if (_has_tangents)  glDisableVertexAttribArray(3);
 
     unbind();
 }
\ No newline at end of file
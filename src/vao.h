@@ -5,24 +5,47 @@
 #include "texture.h"
 #include "vbo.h"
 #include "loader.h"
+#include "mesh.h"
+
+enum class vertex_format
+{
+    full,       // 32-bit floats for every attribute (44 bytes per vertex, 48 with tangent signs)
+    compact,    // Half-float positions, uvs and tangents, 10-bit normals (24 bytes per vertex)
+};
 
 class vao
 {
 public:
-    static std::unique_ptr<vao> create(const obj_mesh& m);
+    // Takes an obj_mesh or a mesh_arena, vertices are written straight 
+    // into the mapped vertex buffer
+    static std::unique_ptr<vao> create(const mesh_view& m,
+        vertex_format format = vertex_format::full);
+
+    // Pre-packed data is uploaded as is, in the full vertex format
+    static std::unique_ptr<vao> create(const packed_mesh& m);
+    // Mesh index of a finished loader, from its mapped cache when it has one
+    static std::unique_ptr<vao> create(loader& l, int index);
 
-    vao(const float3* vert, const float2* uvs, const float3* normals, 
-        const float3* tangents, int vert_count, const int3* indx, int indx_count);
+    vao(const mesh_view& mesh, vertex_format format = vertex_format::full);
+    explicit vao(const packed_mesh& mesh);
     ~vao();
     void bind();
     void unbind();
     void draw();
+    void draw_instanced(int instances);
+
+    uint32_t size_bytes() const { return _vertexes.size_bytes() + _indexes.size_bytes(); }
 
     vao(vao&& other);
 
 private:
     vao(const vao& other) = delete;
 
+    void upload_full(const mesh_view& mesh);
+    void upload_compact(const mesh_view& mesh);
+    void set_full_attributes(const vertex_layout& layout);
+
     uint32_t _id;
-    vbo _vertexes, _normals, _indexes, _uvs, _tangents;
+    vbo _vertexes, _indexes;
+    bool _has_uvs = false, _has_normals = false, _has_tangents = false;
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <GL/gl3w.h>
 #include <easylogging++.h>
 #include <assert.h>
+#include <algorithm>
 
 int vbo::convert_type(vbo_type type)
 {
@@ -13,6 +14,16 @@ int vbo::convert_type(vbo_type type)
     }
 }
 
+int vbo::convert_type(attribute_type type)
+{
+    switch (type) {
+    case attribute_type::float32: return GL_FLOAT;
+    case attribute_type::half_float: return GL_HALF_FLOAT;
+    case attribute_type::int_2_10_10_10: return GL_INT_2_10_10_10_REV;
+    default: throw std::runtime_error("Not supported attribute type!");
+    }
+}
+
 vbo::vbo(vbo_type type)
     : _type(type)
 {
@@ -36,14 +47,107 @@ void vbo::upload(int attribute, const float* xyz, int size, int count)
     glBufferData(convert_type(_type), count * size * sizeof(float), xyz, GL_STATIC_DRAW);
     glVertexAttribPointer(attribute, size, GL_FLOAT, GL_FALSE, 0, 0);
     _size = count;
+    _bytes = count * size * sizeof(float);
+    unbind();
+}
+
+void vbo::upload(const float* interleaved, int stride, int count)
+{
+    upload((const void*)interleaved, count * stride * (int)sizeof(float), count);
+}
+
+void vbo::upload(const void* data, int bytes, int count)
+{
+    assert(_type == vbo_type::array_buffer);
+    bind();
+    glBufferData(convert_type(_type), bytes, data, GL_STATIC_DRAW);
+    _size = count;
+    _bytes = bytes;
+    unbind();
+}
+
+void vbo::stream(const void* data, int bytes, int count)
+{
+    assert(_type == vbo_type::array_buffer);
+    bind();
+    glBufferData(convert_type(_type), bytes, data, GL_STREAM_DRAW);
+    _size = count;
+    _bytes = bytes;
+    unbind();
+}
+
+void* vbo::map(int bytes, int count)
+{
+    bind();
+    glBufferData(convert_type(_type), bytes, nullptr, GL_STATIC_DRAW);
+    _size = count;
+    _bytes = bytes;
+    if (!bytes) return nullptr;
+
+    auto res = glMapBufferRange(convert_type(_type), 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!res) throw std::runtime_error("Could not map vertex buffer!");
+    return res;
+}
+
+void vbo::unmap()
+{
+    if (_bytes && glUnmapBuffer(convert_type(_type)) == GL_FALSE)
+        throw std::runtime_error("Vertex buffer contents were lost!");
+
+    // Element array binding is part of the vao state, leave it bound
+    if (_type == vbo_type::array_buffer) unbind();
+}
+
+void vbo::set_attribute(int attribute, int size, int stride, int offset)
+{
+    set_attribute(attribute, size, attribute_type::float32,
+        stride * sizeof(float), offset * sizeof(float));
+}
+
+void vbo::set_attribute(int attribute, int size, attribute_type type,
+    int stride_bytes, int offset_bytes)
+{
+    assert(_type == vbo_type::array_buffer);
+    bind();
+    auto normalized = type == attribute_type::int_2_10_10_10 ? GL_TRUE : GL_FALSE;
+    glVertexAttribPointer(attribute, size, convert_type(type), normalized,
+        stride_bytes, (void*)(size_t)offset_bytes);
     unbind();
 }
 
 void vbo::upload(const int3* indx, int count)
+{
+    assert(_type == vbo_type::element_array_buffer);
+
+    int max_index = 0;
+    for (int i = 0; i < count; i++)
+        max_index = std::max(max_index, std::max(indx[i].x, std::max(indx[i].y, indx[i].z)));
+
+    // Small meshes (all of the tubes and glass peices) fit into 16-bit indexes,
+    // narrowed while writing into the mapped buffer
+    if (max_index < 65536)
+    {
+        auto dst = (uint16_t*)map(count * 3 * (int)sizeof(uint16_t), count);
+        for (int i = 0; i < count; i++)
+        {
+            dst[i * 3 + 0] = (uint16_t)indx[i].x;
+            dst[i * 3 + 1] = (uint16_t)indx[i].y;
+            dst[i * 3 + 2] = (uint16_t)indx[i].z;
+        }
+        unmap();
+        _index_type = GL_UNSIGNED_SHORT;
+    }
+    else upload_indexes(indx, count, false);
+}
+
+void vbo::upload_indexes(const void* indx, int count, bool short_indexes)
 {
     assert(_type == vbo_type::element_array_buffer);
     bind();
-    glBufferData(convert_type(_type), count * sizeof(int3), indx, GL_STATIC_DRAW);
+    _bytes = count * 3 * (short_indexes ? sizeof(uint16_t) : sizeof(uint32_t));
+    glBufferData(convert_type(_type), _bytes, indx, GL_STATIC_DRAW);
+    _index_type = short_indexes ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
     _size = count;
 }
 
@@ -58,11 +162,18 @@ void vbo::draw_triangles()
 void vbo::draw_indexed_triangles()
 {
     assert(_type == vbo_type::element_array_buffer);
-    glDrawElements(GL_TRIANGLES, _size * (sizeof(int3) / sizeof(int)), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, _size * 3, _index_type, 0);
+}
+
+void vbo::draw_indexed_triangles_instanced(int instances)
+{
+    assert(_type == vbo_type::element_array_buffer);
+    glDrawElementsInstanced(GL_TRIANGLES, _size * 3, _index_type, 0, instances);
 }
 
 vbo::vbo(vbo&& other)
-    : _id(other._id), _type(other._type), _size(other._size)
+    : _id(other._id), _type(other._type), _size(other._size),
+      _bytes(other._bytes), _index_type(other._index_type)
 {
     other._id = 0;
 }
@@ -9,6 +9,13 @@ enum class vbo_type
     element_array_buffer,
 };
 
+enum class attribute_type
+{
+    float32,
+    half_float,
+    int_2_10_10_10, // signed, normalized
+};
+
 class vbo
 {
 public:
@@ -18,19 +25,39 @@ public:
 
     void upload(int attribute, const float* xyz, int size, int count);
     void upload(const int3* indx, int count);
+    // Index triplets already narrowed to uint16 (short_indexes) or stored as uint32
+    void upload_indexes(const void* indx, int count, bool short_indexes);
+    void upload(const float* interleaved, int stride, int count);
+    void upload(const void* data, int bytes, int count);
+    // Re-specifies the whole buffer every call, for data rewritten every frame
+    void stream(const void* data, int bytes, int count);
+
+    // Allocates storage for count elements and maps it for writing,
+    // so data can be produced straight into the buffer. Call unmap() before drawing
+    void* map(int bytes, int count);
+    void unmap();
+
+    void set_attribute(int attribute, int size, int stride, int offset);
+    void set_attribute(int attribute, int size, attribute_type type,
+        int stride_bytes, int offset_bytes);
 
     void draw_triangles();
     void draw_indexed_triangles();
+    void draw_indexed_triangles_instanced(int instances);
 
     void bind();
     void unbind();
 
     uint32_t size() const { return _size; }
+    uint32_t size_bytes() const { return _bytes; }
 private:
     vbo(const vbo& other) = delete;
     static int convert_type(vbo_type type);
+    static int convert_type(attribute_type type);
 
     uint32_t _id;
     uint32_t _size = 0;
+    uint32_t _bytes = 0;
+    uint32_t _index_type = 0;
     vbo_type _type;
 };
\ No newline at end of file
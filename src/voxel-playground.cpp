@@ -14,6 +14,10 @@
 #include "tube-shader.h"
 #include "fbo.h"
 #include "procedural.h"
+#include "mesh-optimizer.h"
+#include "lod.h"
+#include "instancing.h"
+#include "tube-grid.h"
 #include "texture-2d-shader.h"
 #include "glass-decals.h"
 #include "textures.h"
@@ -26,6 +30,8 @@ INITIALIZE_EASYLOGGINGPP
 
 #include <math.h>
 #include <map>
+#include <tuple>
+#include <algorithm>
 
 #define LOG_GL_INT(x) { int max_textures = 0;\
 glGetIntegerv(x, &max_textures);\
@@ -42,7 +48,12 @@ struct graphic_objects
     tube_shader tb_shader;
     texture_2d_shader tex_2d_shader;
 
+    // Camera and light, shared by every program through uniform_binding::frame
+    uniform_block<frame_data> frame;
+
     std::shared_ptr<fbo> background_pass, tubes_interior_pass;
+
+    std::unique_ptr<instance_buffer> tube_instances = create_tube_instance_buffer();
 };
 
 struct tube_peice
@@ -52,6 +63,8 @@ struct tube_peice
     bool damaged = false;
     int damaged_idx = 0;
     int glass_decal = 0;
+    int lod = 0; // Not persisted, selected every frame
+    glass_hitpoint hitpoint; // Not persisted, derived from damaged_idx and glass_decal
 
     friend zpp::serializer::access;
     template <typename Archive, typename Self>
@@ -62,6 +75,15 @@ struct tube_peice
     }
 };
 
+// Range of the instance buffer sharing geometry
+struct tube_group
+{
+    int type;
+    int lod;
+    bool damaged;
+    int first, count;
+};
+
 struct save_header
 {
     int version = 1;
@@ -167,10 +189,16 @@ int main(int argc, char* argv[])
 
     bool mipmap = true;
     bool linear = true;
+    float texture_budget = 4.f;
 
-    textures textures;
+    // Assets load concurrently in the background, 
+    // a placeholder is drawn until each one is uploaded
+    worker_pool pool;
+
+    textures textures(pool);
     auto mish = textures.add_texture("diffuse", "resources/texture.png");
-    auto normals = textures.add_texture("normal_map", "resources/normal_map.png");
+    auto normals = textures.add_texture("normal_map", "resources/normal_map.png",
+        texture_usage::normal_map);
     auto world = textures.add_texture("world diffuse", "resources/Diffuse_2K.png");
     auto cat_tex = textures.add_texture("cat diffuse", "resources/cat_diff.tga");
     auto white = textures.add_texture("white", "resources/white.png");
@@ -178,21 +206,18 @@ int main(int argc, char* argv[])
     auto first_pass_color = textures.add_texture("first_pass_color");
     auto second_pass_color = textures.add_texture("second_pass_color");
 
-    auto empty_texture = textures.add_texture("empty");
-
-    glass_atlas glass(textures);
+    glass_atlas glass(pool, textures);
 
     std::vector<tube_peice> tubes;
+    tube_grid grid;
 
     auto reload_textures = [&]() {
         textures.reload_all();
     };
 
-    loader ld("resources/earth.obj");
-    while (!ld.ready());
-
-    loader cat_ld("resources/cat.obj");
-    while (!cat_ld.ready());
+    loader ld(pool, "resources/earth.obj");
+    loader cat_ld(pool, "resources/cat.obj");
+    auto placeholder = make_cube(1.f);
 
     light l;
     l.position = { 100.f, 0.f, -20.f };
@@ -203,10 +228,10 @@ int main(int argc, char* argv[])
     auto diffuse_level = 0.6f;
     auto light_angle = 0.f;
     bool rotate_light = true;
+    bool normal_mapping = true;
+    bool refraction = true;
     float fov = 80.f;
 
-    int a = 27;
-    int b = 27;
     float radius = 1.f;
     float length = 3.f;
 
@@ -240,15 +265,31 @@ int main(int argc, char* argv[])
     };
 
     std::vector<const char*> tubes_names;
-    std::vector<std::shared_ptr<vao>> tube_vaos;
-    std::vector<obj_mesh*> tube_meshes;
-    std::map<std::string, obj_mesh> tube_types;
+    // Indexed by tube type, then by level of detail (0 is the finest)
+    std::vector<std::vector<std::shared_ptr<vao>>> tube_vaos;
+    std::vector<const mesh_arena*> tube_meshes;
+    std::vector<bounding_sphere> tube_bounds;
+    std::vector<std::map<std::string, mesh_arena>> tube_lods;
     int tube_idx = 0;
 
-    {
-        auto cylinder = generate_tube(length, radius, 0.f, a, b);
-        auto bent_cylinder = generate_tube(length, radius, -1.f, a, b);
-        auto cap = generate_cap(1.f, radius, 0.5f);
+    const float lod_details[] = { 1.f, 0.6f, 0.375f, 0.25f };
+    lod_selector tube_lod_selector({ 240.f, 120.f, 60.f });
+    bool enable_lod = true;
+
+    // Rebuilt every frame from the camera
+    frustum view_frustum;
+    bool enable_culling = true;
+    std::vector<int> visible_tubes, culling_candidates;
+    sphere_batch culling_spheres;
+    bounding_sphere earth_bounds, cat_bounds, grid_bounds;
+    int objects_visible = 0, objects_culled = 0;
+    uniform_statistics uniform_stats;
+
+    auto generate_tube_types = [&](float detail) {
+        std::map<std::string, obj_mesh> tube_types;
+
+        auto k = [&](int n) { return std::max(8, (int)(n * detail + 0.5f)); };
+
         float3x3 r{
             { 0.f, 0.f, 1.f },
             { 0.f, 1.f, 0.f },
@@ -260,110 +301,123 @@ int main(int argc, char* argv[])
             { 0.f, 0.f, 1.f }
         };
 
-        auto t2x2h = generate_tube(2.f, 1.f, 0, 1, 32);
-        auto t2x2l = generate_tube(2.f, 1.f, 0, 1, 12);
-        tube_types["2x2,1,H"] = apply(
-            t2x2h, id, { 0.f, 0.f, 0.5f });
-        tube_types["2x2,1,L"] = apply(
-            t2x2l, id, { 0.f, 0.f, 0.5f });
-
-        tube_types["2x2,2,H"] = apply(
-            t2x2h, r, { 0.0f, 0.f, 0.5f });
-        tube_types["2x2,2,L"] = apply(
-            t2x2l, r, { 0.f, 0.f, 0.5f });
-
-        auto v2x3h = generate_tube(3.f, 1.f, 0, 1, 32);
-        auto v2x3l = generate_tube(3.f, 1.f, 0, 1, 12);
-        tube_types["2x3,1,H"] = v2x3h;
-        tube_types["2x3,1,L"] = v2x3l;
-
-        tube_types["2x3,2,H"] = apply(
-            v2x3h, r, { 0.5f, 0.f, 0.5f });
-        tube_types["2x3,2,L"] = apply(
-            v2x3l, r, { 0.5f, 0.f, 0.5f }, true);
-
-        tube_types["2x3,3,H"] = apply(
-            v2x3h, id, { 0.f, 0.f, 1.f });
-        tube_types["2x3,3,L"] = apply(
-            v2x3l, id, { 0.f, 0.f, 1.f }, true);
-
-        tube_types["2x3,4,H"] = apply(
-            v2x3h, r, { -0.5f, 0.f, 0.5f });
-        tube_types["2x3,4,L"] = apply(
-            v2x3l, r, { -0.5f, 0.f, 0.5f }, true);
-
-        auto t3x3h = generate_tube(3.f, 1.f, -1.f, 32, 32);
-        auto t3x3l = generate_tube(3.f, 1.f, -1.f, 12, 12);
-        tube_types["3x3,1,H"] = apply(
-            t3x3h, id, { 0.f, 0.f, 0.f });
-        tube_types["3x3,2,H"] = apply(
-            t3x3h, r, { 0.5f, 0.f, 0.5f });
-        tube_types["3x3,3,H"] = apply(
-            t3x3h, mul(r, r), { 0.f, 0.f, 1.f });
-        tube_types["3x3,4,H"] = apply(
-            t3x3h, mul(r, mul(r, r)), { -0.5f, 0.f, 0.5f });
-
-        tube_types["3x3,1,L"] = apply(
-            t3x3l, id, { 0.f, 0.f, 0.f });
-        tube_types["3x3,2,L"] = apply(
-            t3x3l, r, { 0.5f, 0.f, 0.5f });
-        tube_types["3x3,3,L"] = apply(
-            t3x3l, mul(r, r), { 0.f, 0.f, 1.f });
-        tube_types["3x3,4,L"] = apply(
-            t3x3l, mul(r, mul(r, r)), { -0.5f, 0.f, 0.5f });
-
-        auto t4x3h = generate_tube3(length, radius, 16, 16);
-        auto t4x3l = generate_tube3(length, radius, 16, 16);
-        tube_types["4x3,1,H"] = apply(
-            t4x3h, id, { 0.f, 0.f, 1.f });
-        tube_types["4x3,1,L"] = apply(
-            t4x3l, id, { 0.f, 0.f, 1.f });
-
-        tube_types["4x3,2,H"] = apply(
-            t4x3h, r, { -0.5f, 0.f, 0.5f });
-        tube_types["4x3,2,L"] = apply(
-            t4x3l, r, { -0.5f, 0.f, 0.5f });
-
-        tube_types["4x3,3,H"] = apply(
-            t4x3h, mul(r, r), { 0.f, 0.f, 0.f });
-        tube_types["4x3,3,L"] = apply(
-            t4x3l, mul(r, r), { 0.f, 0.f, 0.f });
-
-        tube_types["4x3,4,H"] = apply(
-            t4x3h, mul(r, mul(r, r)), { 0.5f, 0.f, 0.5f });
-        tube_types["4x3,4,L"] = apply(
-            t4x3l, mul(r, mul(r, r)), { 0.5f, 0.f, 0.5f });
-
-        auto t4x4h = generate_tube4(length, radius, -1.f, 16, 16);
-        auto t4x4l = generate_tube4(length, radius, -1.f, 16, 16);
-        tube_types["4x4,1,H"] = apply(
-            t4x4h, id, { 0.f, 0.f, 1.f });
-        tube_types["4x4,1,L"] = apply(
-            t4x4l, id, { 0.f, 0.f, 1.f });
-    }
+        auto t2x2 = generate_tube(2.f, 1.f, 0, 1, k(32));
+        tube_types["2x2,1"] = apply(
+            t2x2, id, { 0.f, 0.f, 0.5f });
+        tube_types["2x2,2"] = apply(
+            t2x2, r, { 0.0f, 0.f, 0.5f });
+
+        auto v2x3 = generate_tube(3.f, 1.f, 0, 1, k(32));
+        tube_types["2x3,1"] = v2x3;
+        tube_types["2x3,2"] = apply(
+            v2x3, r, { 0.5f, 0.f, 0.5f });
+        tube_types["2x3,3"] = apply(
+            v2x3, id, { 0.f, 0.f, 1.f });
+        tube_types["2x3,4"] = apply(
+            v2x3, r, { -0.5f, 0.f, 0.5f });
+
+        auto t3x3 = generate_tube(3.f, 1.f, -1.f, k(32), k(32));
+        tube_types["3x3,1"] = apply(
+            t3x3, id, { 0.f, 0.f, 0.f });
+        tube_types["3x3,2"] = apply(
+            t3x3, r, { 0.5f, 0.f, 0.5f });
+        tube_types["3x3,3"] = apply(
+            t3x3, mul(r, r), { 0.f, 0.f, 1.f });
+        tube_types["3x3,4"] = apply(
+            t3x3, mul(r, mul(r, r)), { -0.5f, 0.f, 0.5f });
+
+        auto t4x3 = generate_tube3(length, radius, k(16), k(16), detail);
+        tube_types["4x3,1"] = apply(
+            t4x3, id, { 0.f, 0.f, 1.f });
+        tube_types["4x3,2"] = apply(
+            t4x3, r, { -0.5f, 0.f, 0.5f });
+        tube_types["4x3,3"] = apply(
+            t4x3, mul(r, r), { 0.f, 0.f, 0.f });
+        tube_types["4x3,4"] = apply(
+            t4x3, mul(r, mul(r, r)), { 0.5f, 0.f, 0.5f });
+
+        auto t4x4 = generate_tube4(length, radius, -1.f, k(16), k(16));
+        tube_types["4x4,1"] = apply(
+            t4x4, id, { 0.f, 0.f, 1.f });
+
+        // Tube vertex indices are persisted (tube_peice::damaged_idx), 
+        // so only the triangle order is optimized
+        LOG(INFO) << "Optimizing tube meshes, detail " << detail << " (ACMR / ATVR):";
+        for (auto& kvp : tube_types)
+        {
+            auto before = analyze_vertex_cache(kvp.second);
+            optimize_mesh(kvp.second, false);
+            auto after = analyze_vertex_cache(kvp.second);
+            LOG(INFO) << kvp.first << ": " 
+                << before.acmr << " / " << before.atvr << " -> "
+                << after.acmr << " / " << after.atvr;
+        }
+
+        // Kept packed for the lifetime of the scene, uploads read the arenas directly
+        std::map<std::string, mesh_arena> arenas;
+        for (auto& kvp : tube_types)
+            arenas.emplace(kvp.first, mesh_arena(kvp.second));
+        return arenas;
+    };
+
+    for (auto detail : lod_details)
+        tube_lods.push_back(generate_tube_types(detail));
+
+    // Hit-points and bounds always refer to the finest level
+    auto& tube_types = tube_lods.front();
+
+    // GL objects can only be created here, on the render thread
+    auto upload_loaded = [&](loader& l, std::shared_ptr<vao>& geometry, bounding_sphere& bounds) {
+        if (l.ready() && l.mesh_count() > 0)
+        {
+            geometry = vao::create(l, 0);
+            bounds = l.bounds().front();
+        }
+        else
+        {
+            geometry = vao::create(placeholder);
+            bounds = calculate_bounding_sphere(placeholder);
+        }
+    };
 
     auto reload_models = [&]() {
         tube_vaos.clear();
         tubes_names.clear();
         tube_meshes.clear();
-        int counter = 0;
+        tube_bounds.clear();
         for (auto& kvp : tube_types)
         {
-            if (counter++ % 2)
-                tubes_names.push_back(kvp.first.c_str());
-            tube_vaos.push_back(vao::create(kvp.second));
+            tubes_names.push_back(kvp.first.c_str());
             tube_meshes.push_back(&kvp.second);
+            tube_bounds.push_back(calculate_bounding_sphere(kvp.second));
+
+            std::vector<std::shared_ptr<vao>> levels;
+            for (auto& lod : tube_lods)
+                levels.push_back(vao::create(lod.at(kvp.first), vertex_format::compact));
+            tube_vaos.push_back(levels);
         }
         tube_idx = tubes_names.size() - 1;
 
+        float3 cell_lo = tube_bounds.front().center, cell_hi = cell_lo;
+        for (auto& b : tube_bounds)
+        {
+            cell_lo = min(cell_lo, b.center - b.radius);
+            cell_hi = max(cell_hi, b.center + b.radius);
+        }
+        grid.set_cell_bounds(cell_lo, cell_hi);
+
         app->is_alive();
 
+        textures.finish(white);
         glass.generate_decals(white);
         app->is_alive();
 
-        go->grid = vao::create(make_grid(20, 20, 1.f, 1.f));
-        go->cat = vao::create(cat_ld.get().front());
-        go->earth = vao::create(ld.get().front());
+        auto grid_mesh = make_grid(20, 20, 1.f, 1.f);
+        grid_bounds = calculate_bounding_sphere(grid_mesh);
+        go->grid = vao::create(grid_mesh);
+
+        upload_loaded(ld, go->earth, earth_bounds);
+        upload_loaded(cat_ld, go->cat, cat_bounds);
     };
 
     auto reload_graphics = [&]() {
@@ -375,14 +429,79 @@ int main(int argc, char* argv[])
     };
     reload_graphics();
 
-    float4x4 matrix;
+    // Hit-point frame only changes when a tube gets damaged or loaded,
+    // so it is computed once instead of every frame
+    auto update_hitpoint = [&](tube_peice& t) {
+        auto trans = translation_matrix(float3{ (float)t.pos.x, 0.f, (float)t.pos.y });
+        t.hitpoint = glass.calculate_hitpoint(*tube_meshes[t.type], trans, 
+            t.damaged_idx, t.glass_decal);
+    };
+
+    auto update_hitpoints = [&]() {
+        for (auto& t : tubes)
+            if (t.damaged) update_hitpoint(t);
+    };
+
+    // Rebuilds the grid after the tube list was replaced,
+    // dropping tubes that share a cell with an earlier one
+    auto reindex_tubes = [&]() {
+        grid.clear();
+        visible_tubes.clear();
+        std::vector<tube_peice> unique;
+        unique.reserve(tubes.size());
+        for (auto& t : tubes)
+            if (grid.insert(t.pos, unique.size())) unique.push_back(t);
+
+        if (unique.size() != tubes.size())
+            LOG(INFO) << "Dropped " << tubes.size() - unique.size() << " overlapping tubes";
+        tubes = std::move(unique);
+    };
+
+    // Tubes inside the view frustum: coarse chunk test through the grid,
+    // then bounding spheres of the remaining tubes in one batch
+    auto cull_tubes = [&]() {
+        visible_tubes.clear();
+        if (!enable_culling)
+        {
+            for (size_t i = 0; i < tubes.size(); i++) visible_tubes.push_back((int)i);
+            return;
+        }
+
+        culling_candidates.clear();
+        grid.query_frustum(view_frustum, culling_candidates);
+
+        culling_spheres.clear();
+        culling_spheres.reserve(culling_candidates.size());
+        for (auto i : culling_candidates)
+        {
+            auto& tb = tubes[i];
+            auto& b = tube_bounds[tb.type];
+            culling_spheres.add(b.center + float3{ (float)tb.pos.x, 0.f, (float)tb.pos.y }, b.radius);
+        }
+
+        culling_spheres.cull(view_frustum, visible_tubes);
+        for (auto& v : visible_tubes) v = culling_candidates[v];
+    };
+
+    // Objects drawn in several passes are only counted in one of them
+    auto object_visible = [&](const bounding_sphere& b, const float4x4& model, float scale, bool count) {
+        if (!enable_culling) return true;
+        auto center = mul(model, float4(b.center, 1.f)).xyz();
+        auto visible = view_frustum.intersects(center, b.radius * scale);
+        if (count && visible) objects_visible++;
+        else if (count) objects_culled++;
+        return visible;
+    };
 
     auto draw_stuff_inside = [&]()
     {
-        go->shader.set_model(mul(
+        auto model = mul(
             translation_matrix(float3{ 0.f, -0.6f, -2.f }),
             scaling_matrix(float3{ 1.5f, 1.5f, 1.5f })
-        ));
+        );
+        if (!object_visible(cat_bounds, model, 1.5f, true)) return;
+
+        go->shader.set_model(model);
 
         textures.with_texture(cat_tex, 0, [&]() {
             go->cat->draw();
@@ -391,7 +510,8 @@ int main(int argc, char* argv[])
 
     bool show_grid = false;
 
-    auto draw_refractables = [&](float t) {
+    // Drawn once into the refraction source and once more in the final pass
+    auto draw_refractables = [&](float t, bool final_pass) {
         double factor = sin(t / 2.0);
         double x = -0.2 * factor;
         double y = -0.8 * factor;
@@ -400,22 +520,28 @@ int main(int argc, char* argv[])
         float4 q(x, y, z, w);
         q = normalize(q);
 
-        go->shader.set_model(mul(
+        auto earth_model = mul(
             translation_matrix(float3{ 0.f, -9.f, -5.f }),
             scaling_matrix(float3{ 2.f, 2.f, 2.f }),
             rotation_matrix(q)
-        ));
+        );
 
-        textures.with_texture(world, 0, [&]() {
-            go->earth->draw();
-        });
+        if (object_visible(earth_bounds, earth_model, 2.f, final_pass))
+        {
+            go->shader.set_model(earth_model);
 
-        go->shader.set_model(mul(
+            textures.with_texture(world, 0, [&]() {
+                go->earth->draw();
+            });
+        }
+
+        auto grid_model = mul(
             translation_matrix(float3{ 0.f, -1.f, 0.5f }),
             scaling_matrix(float3{ 1.f, 1.f, 1.f })
-        ));
+        );
+        go->shader.set_model(grid_model);
 
-        if (show_grid)
+        if (show_grid && object_visible(grid_bounds, grid_model, 1.f, final_pass))
         {
             glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
             textures.with_texture(white, 0, [&]() {
@@ -436,11 +562,56 @@ int main(int argc, char* argv[])
     float3 pos;
     bool build_tool_active = false;
 
+    std::vector<tube_group> tube_groups;
+    std::vector<tube_instance> instances;
+
+    // Groups tubes by shader variant and geometry and uploads per-instance data, 
+    // once per frame for all the passes. Intact tubes come first and use
+    // the variant that does not sample the decal atlases
+    auto prepare_instances = [&]() {
+        std::vector<int> order = visible_tubes;
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            auto& x = tubes[a];
+            auto& y = tubes[b];
+            return std::make_tuple(x.damaged, x.type, x.lod) <
+                   std::make_tuple(y.damaged, y.type, y.lod);
+        });
+
+        instances.clear();
+        tube_groups.clear();
+        for (auto i : order)
+        {
+            auto& t = tubes[i];
+            tube_instance inst;
+            inst.model = translation_matrix(float3{ (float)t.pos.x, 0.f, (float)t.pos.y });
+            inst.decal = { 0.f, 0.f, 0.f, 0.f };
+            if (t.damaged)
+            {
+                auto& hp = t.hitpoint;
+                inst.decal = { hp.uvs.x, hp.uvs.y, (float)hp.decal_id, 0.f };
+            }
+
+            if (tube_groups.empty() || 
+                tube_groups.back().damaged != t.damaged ||
+                tube_groups.back().type != t.type ||
+                tube_groups.back().lod != t.lod)
+            {
+                tube_groups.push_back({ t.type, t.lod, t.damaged, (int)instances.size(), 0 });
+            }
+            tube_groups.back().count++;
+            instances.push_back(inst);
+        }
+
+        go->tube_instances->upload(instances);
+    };
+
     auto draw_tubes = [&](texture_handle refraction_id, int tube_type) {
         textures.with_texture(mish, go->tb_shader.diffuse_slot(), [&]() {
         textures.with_texture(normals, go->tb_shader.normal_map_slot(), [&]() {
         textures.with_texture(refraction_id, go->tb_shader.refraction_slot(), [&]() {
-            go->tb_shader.enable_normal_mapping(true);
+            int features = (normal_mapping ? tube_shader::normal_mapping : 0) |
+                           (refraction ? tube_shader::refraction : 0);
+            go->tb_shader.select(features);
 
             if (build_tool_active)
             {
@@ -448,7 +619,7 @@ int main(int argc, char* argv[])
                     translation_matrix(pos),
                     scaling_matrix(float3{ 1.f, 1.f, 1.f })
                 ));
-                tube_vaos[tube_type * 2]->draw();
+                tube_vaos[tube_type].front()->draw();
             }
 
             //go->tb_shader.set_model(mul(
@@ -465,32 +636,20 @@ int main(int argc, char* argv[])
             //));
             //go->tube->draw();
 
-            for (auto& t : tubes)
-            {
-                auto trans = mul(
-                    translation_matrix(float3{ (float)t.pos.x, 0.f, (float)t.pos.y }),
-                    scaling_matrix(float3{ 1.f, 1.f, 1.f })
-                );
-                go->tb_shader.set_model(trans);
-                if (t.damaged)
-                {
-                    glass.set_hitpoint(*tube_meshes[t.type * 2], trans, t.damaged_idx, t.glass_decal);
-                    glass.prepare_decal(go->tb_shader);
-                    textures.with_texture(glass.diffuse(), go->tb_shader.glass_atlas_slot(), [&]() {
-                    textures.with_texture(glass.outline(), go->tb_shader.decal_atlas_slot(), [&]() {
-                        tube_vaos[t.type * 2]->draw();
-                    });
-                    });
-                }
-                else
+            // Decal id and uvs come from the instance buffer,
+            // the decal atlases are bound once for every group
+            go->tb_shader.set_decal_variations(glass.glass_variations);
+            go->tb_shader.enable_instancing(true);
+            textures.with_texture(glass.diffuse(), go->tb_shader.glass_atlas_slot(), [&]() {
+            textures.with_texture(glass.outline(), go->tb_shader.decal_atlas_slot(), [&]() {
+                for (auto& g : tube_groups)
                 {
-                    textures.with_texture(empty_texture, go->tb_shader.glass_atlas_slot(), [&]() {
-                    textures.with_texture(empty_texture, go->tb_shader.decal_atlas_slot(), [&]() {
-                        tube_vaos[t.type * 2]->draw();
-                    });
-                    });
+                    go->tb_shader.select(features | (g.damaged ? tube_shader::damaged : 0));
+                    go->tube_instances->draw(*tube_vaos[g.type][g.lod], g.first, g.count);
                 }
-            }
+            });
+            });
+            go->tb_shader.enable_instancing(false);
 
             /*go->tb_shader.set_model(mul(
                 translation_matrix(float3{ 0.f, 0.f, -3.f }),
@@ -514,24 +673,19 @@ int main(int argc, char* argv[])
         textures.with_texture(mish, go->tb_shader.diffuse_slot(), [&]() {
         textures.with_texture(normals, go->tb_shader.normal_map_slot(), [&]() {
         textures.with_texture(refraction_id, go->tb_shader.refraction_slot(), [&]() {
-            for (auto& tb : tubes)
+            go->tb_shader.select(refraction ? tube_shader::refraction : 0);
+
+            for (auto i : visible_tubes)
             {
+                auto& tb = tubes[i];
                 if (tb.damaged)
                 {
-                    auto trans = mul(
-                        translation_matrix(float3{ (float)tb.pos.x, 0.f, (float)tb.pos.y }),
-                        scaling_matrix(float3{ 1.f, 1.f, 1.f })
-                    );
-                    glass.set_hitpoint(*tube_meshes[tb.type * 2], trans, tb.damaged_idx, tb.glass_decal);
-                    
-                    glass.draw_scatter(t, go->tb_shader);
+                    glass.draw_scatter(t, go->tb_shader, tb.hitpoint);
                 }
             }
         });
         });
         });
-
-        go->tb_shader.enable_normal_mapping(true);
     };
 
     bool fullscreen = false;
@@ -567,6 +721,8 @@ int main(int argc, char* argv[])
     if (file_exists("resources/save.dat"))
     {
         load_tubes(tubes);
+        reindex_tubes();
+        update_hitpoints();
     }
 
     while (app->is_alive() && !exit)
@@ -591,13 +747,13 @@ int main(int argc, char* argv[])
 
         if (build_tool_active && app->get_mouse().x > 250)
         {
-            if (ImGui::IsMouseClicked(1)) tube_type = (tube_type + 1) % (tube_vaos.size() / 2);
+            if (ImGui::IsMouseClicked(1)) tube_type = (tube_type + 1) % tube_vaos.size();
             if (ImGui::IsMouseClicked(0))
             {
                 tube_peice tb;
                 tb.pos = { (int)pos.x, (int)pos.z };
                 tb.type = tube_type;
-                tubes.push_back(tb);
+                if (grid.insert(tb.pos, tubes.size())) tubes.push_back(tb);
             }
         }
 
@@ -617,17 +773,53 @@ int main(int argc, char* argv[])
 
         cam->update(*app);
 
+        uniform_stats = shader_program::statistics();
+        shader_program::reset_statistics();
+
+        textures.begin_frame();
+        textures.update(texture_budget);
+        if (ld.poll()) upload_loaded(ld, go->earth, earth_bounds);
+        if (cat_ld.poll()) upload_loaded(cat_ld, go->cat, cat_bounds);
+
+        view_frustum = frustum(mul(cam->projection_matrix(), cam->view_matrix()));
+        objects_visible = objects_culled = 0;
+        cull_tubes();
+
+        for (auto i : visible_tubes)
+        {
+            auto& tb = tubes[i];
+            if (!enable_lod)
+            {
+                tb.lod = 0;
+                continue;
+            }
+            auto sphere = tube_bounds[tb.type];
+            sphere.center += float3{ (float)tb.pos.x, 0.f, (float)tb.pos.y };
+            auto size = projected_size(sphere, cam->view_matrix(), 
+                cam->projection_matrix(), cam->is_perspective(), app->height());
+            tb.lod = tube_lod_selector.select(size, tb.lod);
+        }
+
+        prepare_instances();
+
+        frame_data fd;
+        fd.view = cam->view_matrix();
+        fd.projection = cam->projection_matrix();
+        fd.camera_position = mul(inverse(fd.view), float4{ 0.f, 0.f, 0.f, 1.f });
+        fd.light_position = { l.position, 1.f };
+        fd.light_colour = { l.colour, 1.f };
+        go->frame.set(fd);
+        go->frame.bind(uniform_binding::frame);
+
         go->shader.begin();
 
         go->shader.set_material_properties(diffuse_level, shineDamper, reflectivity);
-        go->shader.set_light(l.position);
-        go->shader.set_mvp(matrix, cam->view_matrix(), cam->projection_matrix());
 
         go->background_pass->bind();
         glClearColor(0, 0, 0, 1);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        draw_refractables(t);
+        draw_refractables(t, false);
 
         go->background_pass->unbind();
 
@@ -643,8 +835,6 @@ int main(int argc, char* argv[])
         go->tb_shader.begin();
 
         go->tb_shader.set_material_properties(diffuse_level, shineDamper, reflectivity);
-        go->tb_shader.set_light(l.position);
-        go->tb_shader.set_mvp(matrix, cam->view_matrix(), cam->projection_matrix());
         go->tb_shader.set_distortion(0.2f);
 
         glDisable(GL_DEPTH_TEST);
@@ -684,7 +874,7 @@ int main(int argc, char* argv[])
         go->tb_shader.end();
         go->shader.begin();
 
-        draw_refractables(t);
+        draw_refractables(t, true);
 
         go->shader.end();
 
@@ -724,18 +914,27 @@ int main(int argc, char* argv[])
 
         ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
 
+        for (auto l : { &ld, &cat_ld })
+        {
+            if (!l->ready())
+                ImGui::Text("Loading %s: %.0f%%", l->filename().c_str(), l->progress() * 100.f);
+        }
+        if (textures.pending())
+            ImGui::Text("Streaming %d textures", textures.pending());
+
         if (ImGui::Button("Exit to Desktop", { 235, 0 }))
             exit = true;
 
         if (ImGui::CollapsingHeader("Controls", ImGuiTreeNodeFlags_DefaultOpen))
         {
-            if (ImGui::Button("Randomize"))
+            if (ImGui::Button("Randomize") && !tubes.empty())
             {
                 int random_tube = rand() % tubes.size();
                 auto& t = tubes[random_tube];
                 t.damaged = true;
-                t.damaged_idx = rand() % tube_meshes[t.type * 2]->positions.size();
+                t.damaged_idx = rand() % tube_meshes[t.type]->vertex_count();
                 t.glass_decal = rand();
+                update_hitpoint(t);
             }
 
             if (ImCheckButton(&build_tool_active, "Exit Build Mode", "Enter Build Mode"))
@@ -743,12 +942,22 @@ int main(int argc, char* argv[])
                 tube_type = 0;
             }
 
-            if (ImGui::Button("Clear", { 70, 0 })) tubes.clear();
+            if (ImGui::Button("Clear", { 70, 0 }))
+            {
+                tubes.clear();
+                grid.clear();
+                visible_tubes.clear();
+            }
             ImGui::SameLine();
             if (ImGui::Button("Save", { 75, 0 })) save_tubes(tubes);
 
             ImGui::SameLine();
-            if (ImGui::Button("Load", { 75, 0 })) load_tubes(tubes);
+            if (ImGui::Button("Load", { 75, 0 }))
+            {
+                load_tubes(tubes);
+                reindex_tubes();
+                update_hitpoints();
+            }
 
             ImGui::Checkbox("Display Grid", &show_grid);
         }
@@ -767,6 +976,9 @@ int main(int argc, char* argv[])
             ImGui::PushItemWidth(-1);
             ImGui::SliderFloat("##Diffuse", &diffuse_level, 0.f, 1.f);
 
+            ImGui::Checkbox("Normal Mapping", &normal_mapping);
+            ImGui::Checkbox("Refraction", &refraction);
+
             ImGui::Checkbox("Rotate Light", &rotate_light);
             ImGui::PushItemWidth(-1);
             ImGui::SliderFloat("##Rotation", &light_angle, 0.f, 2 * 3.14f);
@@ -779,9 +991,18 @@ int main(int argc, char* argv[])
             {
                 linear = tex_settings[tex_setting].x;
                 mipmap = tex_settings[tex_setting].y;
-                reload_textures();
+                for (auto& to : textures.get_texture_objects())
+                {
+                    if (to.get_filename() == "") continue;
+                    to.linear() = linear;
+                    to.mipmap() = mipmap;
+                }
             }
 
+            ImGui::Text("Upload Budget (ms per frame):");
+            ImGui::PushItemWidth(-1);
+            ImGui::SliderFloat("##UploadBudget", &texture_budget, 0.5f, 16.f);
+
             if (ImGui::Combo("Refraction Resolution", &fbo_resolution,
                 fbo_resolution_names, total_fbo_res))
             {
@@ -791,6 +1012,24 @@ int main(int argc, char* argv[])
 
         if (ImGui::CollapsingHeader("Model Settings"))
         {
+            long tube_bytes = 0;
+            for (auto& levels : tube_vaos)
+                for (auto& v : levels) tube_bytes += v->size_bytes();
+            auto tube_bytes_str = bytes_to_string(tube_bytes);
+            ImGui::Text("Tube Geometry Memory: %s", tube_bytes_str.c_str());
+            ImGui::Text("Tubes: %d in %d grid chunks", grid.size(), grid.chunk_count());
+
+            ImGui::Checkbox("Frustum Culling", &enable_culling);
+            ImGui::Text("Visible Tubes: %d (%d culled)", (int)visible_tubes.size(),
+                (int)(tubes.size() - visible_tubes.size()));
+            ImGui::Text("Visible Objects: %d (%d culled)", objects_visible, objects_culled);
+
+            std::vector<int> lod_counts(tube_lod_selector.levels(), 0);
+            for (auto i : visible_tubes) lod_counts[tubes[i].lod]++;
+            ImGui::Checkbox("Level of Detail", &enable_lod);
+            for (size_t i = 0; i < lod_counts.size(); i++)
+                ImGui::Text("LOD %d: %d tubes", (int)i, lod_counts[i]);
+
             if (ImGui::Combo("Model Type", &tube_idx,
                 tubes_names.data(), tubes_names.size()))
             {
@@ -882,27 +1121,45 @@ int main(int argc, char* argv[])
 
         std::vector<std::function<void()>> later;
 
+        if (ImGui::CollapsingHeader("Shaders"))
+        {
+            auto& registry = app->shaders();
+            ImGui::Text("Programs: %d (%d shared)", registry.size(), registry.hits());
+            ImGui::Text("Uniform Updates: %d issued, %d skipped", 
+                uniform_stats.issued, uniform_stats.skipped);
+        }
+
         if (ImGui::CollapsingHeader("Textures"))
         {
             static int selected_texture = 0;
             std::vector<const char*> texture_names;
             long total_bytes = 0;
-            float load_time = 0.f;
+            float decode_time = 0.f, upload_time = 0.f;
             for (auto& to : textures.get_texture_objects())
             {
                 total_bytes += to.get().get_bytes();
-                load_time += to.get().get_load_time();
+                decode_time += to.get().get_decode_time();
+                upload_time += to.get().get_upload_time();
                 texture_names.push_back(to.get_name().c_str());
             }
             auto bytes_str = bytes_to_string(total_bytes);
             ImGui::Text("Total Texture Memory: %s", bytes_str.c_str());
-            ImGui::Text("Load Time: %f ms", load_time);
+
+            int budget_mb = (int)(textures.budget() >> 20);
+            ImGui::Text("Memory Budget (Mb):");
+            ImGui::PushItemWidth(-1);
+            if (ImGui::SliderInt("##TextureBudget", &budget_mb, 16, 1024))
+                textures.budget() = (size_t)budget_mb << 20;
+            ImGui::Text("Evictions: %d", textures.evictions());
+            ImGui::Text("Decode Time: %f ms", decode_time);
+            ImGui::Text("Upload Time: %f ms", upload_time);
 
             auto& to = textures.get_texture_objects()[selected_texture];
             {
                 std::stringstream ss;
                 auto cur = ImGui::GetCursorScreenPos();
 
+                textures.touch(to);
                 later.push_back([cur, &app, &to, go]() {
                     float2 pos{ ((cur.x + 110.f) / app->width()) * 2.f - 1.f,
                         1.f - ((cur.y + 110.f) / app->height()) * 2.f };
@@ -933,17 +1190,27 @@ int main(int argc, char* argv[])
                 ImGui::SameLine();
                 auto bytes_str = bytes_to_string(to.get().get_bytes());
                 ImGui::Text("%s", bytes_str.c_str());
+                ImGui::Text("Decode %.2f ms, Upload %.2f ms", 
+                    to.get().get_decode_time(), to.get().get_upload_time());
+                if (to.evicted()) ImGui::Text("Evicted, reloads on next use");
 
                 ss.str("");
                 ss << "Linear Filtering##" << to.get_name();
-                if (ImGui::Checkbox(ss.str().c_str(), &to.linear())) reload = true;
+                ImGui::Checkbox(ss.str().c_str(), &to.linear());
 
                 ss.str("");
                 ss << "Mipmap##" << to.get_name();
-                if (ImGui::Checkbox(ss.str().c_str(), &to.mipmap())) reload = true;
+                ImGui::Checkbox(ss.str().c_str(), &to.mipmap());
+
+                if (to.get_filename() != "")
+                {
+                    ss.str("");
+                    ss << "Block Compression##" << to.get_name();
+                    if (ImGui::Checkbox(ss.str().c_str(), &to.compress())) reload = true;
+                }
 
                 if (reload)
-                    to.reload();
+                    textures.reload(to);
             }
 
             ImGui::Combo("##Texture", &selected_texture,
@@ -965,6 +1232,7 @@ int main(int argc, char* argv[])
                 if (ImGui::Begin(ss.str().c_str()))
                 {
                     auto cur = ImGui::GetCursorScreenPos();
+                    textures.touch(to);
 
                     later.push_back([cur, &app, &to, go]() {
                         float2 pos{ ((cur.x + to.get().get_width() / 2.f) / app->width()) * 2.f - 1.f,
@@ -988,7 +1256,7 @@ int main(int argc, char* argv[])
             LOG(INFO) << "Releasing all OpenGL objects and Window";
             go.reset();
             glass.release();
-            for (auto& to : textures.get_texture_objects()) to.release();
+            textures.release_all();
             app.reset();
 
             LOG(INFO) << "Recreating the Window";
@@ -9,6 +9,7 @@
 
 #include "window.h"
 #include "util.h"
+#include "shader.h"
 
 #include <easylogging++.h>
 
@@ -43,6 +44,9 @@ window::~window()
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    // Programs belong to this context
+    _shaders->release();
+
     glfwDestroyWindow(_window);
     glfwTerminate();
 }
@@ -128,6 +132,9 @@ window::window(int w, int h, const char* title, int multisample, bool fullscreen
     glfwMakeContextCurrent(_window);
     glfwSwapInterval(0);
 
+    _shaders = std::make_unique<shader_registry>();
+    _shaders->make_current();
+
     if (gl3wInit()) {
         throw util_exception("Can't initialize OpenGL!");
     }
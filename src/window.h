@@ -2,6 +2,9 @@
 #include <GLFW/glfw3.h>
 
 #include <functional>
+#include <memory>
+
+class shader_registry;
 
 struct mouse_info
 {
@@ -32,6 +35,8 @@ public:
     void reset_viewport();
 
     const mouse_info& get_mouse() const { return _mouse; }
+    // Programs of this window's context
+    shader_registry& shaders() { return *_shaders; }
     std::function<void(std::string)> on_file_drop = [](std::string) {};
 private:
     GLFWwindow* _window;
@@ -42,4 +47,5 @@ private:
     const int _multisample = 4;
     const bool _fullscreen = false;
     bool _to_end_ui = true;
+    std::unique_ptr<shader_registry> _shaders;
 };
\ No newline at end of file
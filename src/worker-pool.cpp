@@ -0,0 +1,45 @@
+#include "worker-pool.h"
+
+#include <algorithm>
+
+worker_pool::worker_pool(int threads)
+{
+    if (threads <= 0) threads = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 0; i < threads; i++)
+        _threads.emplace_back([this]() { worker(); });
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& t : _threads) t.join();
+}
+
+void worker_pool::enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+    }
+    _wake.notify_one();
+}
+
+void worker_pool::worker()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+            if (_jobs.empty()) return;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        job();
+    }
+}
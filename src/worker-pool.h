@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+// Fixed set of threads running submitted jobs in FIFO order.
+// Jobs still queued when the pool is destroyed are run before it returns
+class worker_pool
+{
+public:
+    // 0 picks one thread per core
+    explicit worker_pool(int threads = 0);
+    ~worker_pool();
+
+    template<class F>
+    auto submit(F f) -> std::future<decltype(f())>
+    {
+        typedef decltype(f()) result;
+        auto task = std::make_shared<std::packaged_task<result()>>(std::move(f));
+        auto res = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return res;
+    }
+
+    int size() const { return (int)_threads.size(); }
+
+private:
+    worker_pool(const worker_pool& other) = delete;
+
+    void enqueue(std::function<void()> job);
+    void worker();
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<std::function<void()>> _jobs;
+    bool _stop = false;
+    std::vector<std::thread> _threads;
+};
+
+// Runs f(0) .. f(jobs - 1) on the pool and waits for them. The calling thread
+// takes part and is the only one reporting progress, so this is safe to call
+// from inside a pool job: helpers still queued when the loop runs out of work
+// are skipped rather than waited on. The first exception thrown by a job is rethrown
+template<class F>
+void run_parallel(worker_pool& pool, int jobs, F f, 
+    const std::function<void(float)>& progress = [](float) {})
+{
+    std::atomic<int> next(0), done(0);
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+
+    auto worker = [&](bool report) {
+        for (int i = next++; i < jobs && !failed; i = next++)
+        {
+            try
+            {
+                f(i);
+            }
+            catch (...)
+            {
+                if (!failed.exchange(true)) error = std::current_exception();
+            }
+            done++;
+            if (report) progress((float)done / jobs);
+        }
+    };
+
+    // Outlives this call, helpers only touch the loop after registering as active
+    struct helpers
+    {
+        std::mutex mutex;
+        std::condition_variable finished;
+        int active = 0;
+        bool closed = false;
+    };
+    auto state = std::make_shared<helpers>();
+    auto loop = &worker;
+
+    int helpers_count = std::min(jobs, pool.size() + 1) - 1;
+    for (int i = 0; i < helpers_count; i++)
+    {
+        pool.submit([state, loop]() {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->closed) return;
+                state->active++;
+            }
+            (*loop)(false);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->active == 0) state->finished.notify_all();
+        });
+    }
+    worker(true);
+
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->closed = true;
+        state->finished.wait(lock, [&]() { return state->active == 0; });
+    }
+    if (error) std::rethrow_exception(error);
+}